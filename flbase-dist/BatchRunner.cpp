@@ -0,0 +1,144 @@
+#include "BatchRunner.h"
+#include "FrameArena.h"
+#include "ImageSequenceWriter.h"
+#include "MemoryFootprint.h"
+#include "Profiler.h"
+#include <QElapsedTimer>
+#include <QGLFramebufferObject>
+#include <QGLPixelBuffer>
+#include <QtOpenGL>
+
+#if !defined(GL_TEXTURE_CUBE_MAP_SEAMLESS)
+#define GL_TEXTURE_CUBE_MAP_SEAMLESS 0x884F
+#endif
+
+#if !defined(GL_RGBA32F_ARB)
+#define GL_RGBA32F_ARB 0x8814
+#endif
+
+BatchRunner::BatchRunner( Scene& scene, int width, int height, unsigned int nbFrames, float deltaTime )
+    : _scene( scene )
+    , _width( width )
+    , _height( height )
+    , _nbFrames( nbFrames )
+    , _deltaTime( deltaTime )
+    , _inputScript( 0 )
+    , _paused( false )
+    , _cubeMap( ":/Images/Checker/" )
+{
+}
+
+void BatchRunner::setOutput( const QString& fileName )
+{
+    _output = fileName;
+}
+
+void BatchRunner::setInputScript( InputScript* inputScript )
+{
+    _inputScript = inputScript;
+}
+
+bool BatchRunner::run()
+{
+    // Only provides the context, the frames are rendered in 'framebuffer'
+    QGLPixelBuffer context( QSize( 1, 1 ), QGLFormat( QGL::DepthBuffer ) );
+
+    if ( !context.isValid() || !context.makeCurrent() )
+    {
+        qCritical() << "Cannot create an offscreen OpenGL context";
+        return false;
+    }
+
+    ImageSequenceWriter writer( _output, _width, _height );
+    GLenum format = writer.isFloatingPoint() ? GL_RGBA32F_ARB : GL_RGBA8;
+    QGLFramebufferObject framebuffer( _width, _height, QGLFramebufferObject::Depth, GL_TEXTURE_2D, format );
+
+    if ( !framebuffer.isValid() )
+    {
+        qCritical() << "Cannot create a" << _width << "x" << _height << "framebuffer";
+        return false;
+    }
+
+    framebuffer.bind();
+    initializeGL();
+
+    if ( !_output.isEmpty() )
+        writer.initialize();
+
+    if ( _inputScript )
+    {
+        _inputScript->rewind();
+        _nbFrames = _inputScript->nbFrames();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for ( unsigned int i=0 ; i<_nbFrames ; ++i )
+    {
+        renderFrame();
+
+        if ( !_output.isEmpty() )
+            writer.capture();
+    }
+
+    writer.finish();
+    framebuffer.release();
+
+    qDebug() << _nbFrames << "frames in" << timer.elapsed() / 1000.0 << "s";
+
+    QStringList report = Profiler::profiler().report() + MemoryFootprint::memoryFootprint().report();
+
+    for ( int i=0 ; i<report.size() ; ++i )
+        qDebug() << qPrintable( report[i] );
+
+    return true;
+}
+
+void BatchRunner::initializeGL()
+{
+    glViewport( 0, 0, _width, _height );
+    glEnable( GL_DEPTH_TEST );
+    glEnable( GL_TEXTURE_CUBE_MAP_SEAMLESS );
+    glClearColor( 0.75, 0.75, 0.75, 1 );
+
+    _shader.initialize();
+    _cubeMap.initialize();
+
+    _shader.bind();
+    _cubeMap.bind();
+
+    _scene.resizeViewport( _width, _height );
+}
+
+void BatchRunner::renderFrame()
+{
+    ProfilerScope profilerScope( Profiler::Frame );
+
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+    // Everything allocated in the arenas during the last frame is released
+    FrameArena::newFrame();
+
+    if ( _inputScript && !_inputScript->isFinished() )
+        _timeState.newFrame( _inputScript->replayFrame( _scene, _paused ) );
+    else
+        _timeState.newFrame( _deltaTime );
+
+    // Each image must show the surface of its own frame, so the surface is
+    // never extracted on its thread, even when a replayed script asks for it
+    _scene.sph().setSurfaceThreaded( false );
+
+    _scene.update();
+
+    if ( !_paused )
+        _scene.animate( _timeState );
+
+    _scene.update();
+
+    ProfilerScope renderScope( Profiler::Render );
+    _shader.setupCamera( _scene.activeCamera() );
+    _scene.render( _shader );
+
+    Profiler::profiler().recordFrameAllocations( FrameArena::frameHeapAllocations() );
+}
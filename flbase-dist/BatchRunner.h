@@ -0,0 +1,51 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "Scenes/Scene.h"
+#include "CubeMap.h"
+#include "GLShader.h"
+#include "InputScript.h"
+#include "TimeState.h"
+#include <QString>
+
+/* Runs a scene without a window, for a given number of frames with a fixed
+ * time step. The frames are rendered offscreen, in a framebuffer object of
+ * an offscreen context, and may be saved as an image sequence ( see
+ * ImageSequenceWriter ). With an input script, the script gives the number
+ * of frames, their time steps and the user actions. The surface is always
+ * extracted within its frame, so that two runs give the same images.
+ *
+ * The OpenGL context comes from the Qt platform plugin, so it works on
+ * machines without a display with QT_QPA_PLATFORM=offscreen or minimalegl
+ * and a software OpenGL such as Mesa.
+ */
+
+class BatchRunner
+{
+public:
+    BatchRunner( Scene& scene, int width, int height, unsigned int nbFrames, float deltaTime );
+
+    void setOutput( const QString& fileName );
+    void setInputScript( InputScript* inputScript );
+    bool run();
+
+private:
+    void initializeGL();
+    void renderFrame();
+
+private:
+    Scene& _scene;
+    int _width;
+    int _height;
+    unsigned int _nbFrames;
+    float _deltaTime;
+    QString _output;
+    InputScript* _inputScript;
+    bool _paused;
+
+    GLShader _shader;
+    CubeMap _cubeMap;
+    TimeState _timeState;
+};
+
+#endif // BATCHRUNNER_H
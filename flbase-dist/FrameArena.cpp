@@ -0,0 +1,265 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Where the C library lets the program replace malloc, every heap allocation
+// is counted, including those of QVector and new. Elsewhere, and under the
+// sanitizers which replace it themselves, only the blocks of the arenas are.
+#if defined( __GLIBC__ ) && !defined( __SANITIZE_ADDRESS__ ) && !defined( __SANITIZE_THREAD__ )
+#define COUNT_HEAP_ALLOCATIONS
+#endif
+
+namespace
+{
+    static const size_t alignment = 16;
+
+    std::atomic<unsigned int> heapAllocationCount( 0 );
+    unsigned int frameStartHeapAllocationCount = 0;
+
+    // Only the threads of the frame count: the one calling 'newFrame' and its
+    // OpenMP team, not the surface thread or those of Qt and the drivers
+    thread_local bool isFrameThread = false;
+    bool isTeamCounted = false;
+
+    inline void countHeapAllocation()
+    {
+        if ( isFrameThread )
+            heapAllocationCount.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    struct ThreadArenas
+    {
+        ThreadArenas()
+        {
+#ifdef _OPENMP
+            int nbThreads = omp_get_max_threads();
+#else
+            int nbThreads = 1;
+#endif
+            for ( int i=0 ; i<nbThreads ; ++i )
+                arenas.append( new FrameArena );
+        }
+
+        ~ThreadArenas()
+        {
+            for ( int i=0 ; i<arenas.size() ; ++i )
+                delete arenas[i];
+        }
+
+        QVector<FrameArena*> arenas;
+    };
+
+    ThreadArenas& threadArenas()
+    {
+        static ThreadArenas instance;
+        return instance;
+    }
+}
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+extern "C"
+{
+    void* __libc_malloc( size_t size );
+    void* __libc_calloc( size_t count, size_t size );
+    void* __libc_realloc( void* pointer, size_t size );
+    void* __libc_memalign( size_t alignment, size_t size );
+
+    void* malloc( size_t size ) __THROW
+    {
+        countHeapAllocation();
+        return __libc_malloc( size );
+    }
+
+    void* calloc( size_t count, size_t size ) __THROW
+    {
+        countHeapAllocation();
+        return __libc_calloc( count, size );
+    }
+
+    void* realloc( void* pointer, size_t size ) __THROW
+    {
+        countHeapAllocation();
+        return __libc_realloc( pointer, size );
+    }
+
+    void* memalign( size_t alignment, size_t size ) __THROW
+    {
+        countHeapAllocation();
+        return __libc_memalign( alignment, size );
+    }
+
+    int posix_memalign( void** pointer, size_t alignment, size_t size ) __THROW
+    {
+        countHeapAllocation();
+        *pointer = __libc_memalign( alignment, size );
+        return *pointer ? 0 : ENOMEM;
+    }
+
+    void* aligned_alloc( size_t alignment, size_t size ) __THROW
+    {
+        countHeapAllocation();
+        return __libc_memalign( alignment, size );
+    }
+}
+#endif
+
+FrameArena::FrameArena( size_t initialCapacity )
+    : _offset( 0 )
+    , _previousBlocksUsage( 0 )
+{
+    addBlock( initialCapacity );
+}
+
+FrameArena::~FrameArena()
+{
+    releaseBlocks();
+}
+
+void* FrameArena::allocate( size_t bytes )
+{
+    size_t offset = ( _offset + alignment - 1 ) & ~( alignment - 1 );
+
+    if ( offset + bytes > _blocks.back().size )
+    {
+        addBlock( bytes );
+        offset = 0;
+    }
+
+    _offset = offset + bytes;
+
+    return _blocks.back().data + offset;
+}
+
+void FrameArena::shrinkLast( void* pointer, size_t bytes )
+{
+    // Give back the unused tail of the most recent allocation
+    const Block& block = _blocks.back();
+    size_t offset = static_cast<char*>( pointer ) - block.data;
+
+    assert( offset <= _offset && offset + bytes <= _offset );
+    _offset = offset + bytes;
+}
+
+void FrameArena::reset()
+{
+    // Merge the blocks so the next frame fits in a single one
+    if ( _blocks.size() > 1 )
+    {
+        size_t totalSize = capacity();
+        releaseBlocks();
+        addBlock( totalSize );
+    }
+
+    _offset = 0;
+    _previousBlocksUsage = 0;
+}
+
+size_t FrameArena::used() const
+{
+    return _previousBlocksUsage + _offset;
+}
+
+size_t FrameArena::capacity() const
+{
+    size_t totalSize = 0;
+
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+        totalSize += _blocks[i].size;
+
+    return totalSize;
+}
+
+void FrameArena::newFrame()
+{
+    frameArena().reset();
+
+    QVector<FrameArena*>& arenas = threadArenas().arenas;
+
+    for ( int i=0 ; i<arenas.size() ; ++i )
+        arenas[i]->reset();
+
+    isFrameThread = true;
+
+    // The team stays the same from one parallel region to the next
+    if ( !isTeamCounted )
+    {
+#pragma omp parallel
+        isFrameThread = true;
+
+        isTeamCounted = true;
+    }
+
+    frameStartHeapAllocationCount = heapAllocationCount;
+}
+
+FrameArena& FrameArena::frameArena()
+{
+    static FrameArena arena( 1024 * 1024 );
+    return arena;
+}
+
+FrameArena& FrameArena::threadArena()
+{
+#ifdef _OPENMP
+    int thread = omp_get_thread_num();
+#else
+    int thread = 0;
+#endif
+
+    return *threadArenas().arenas[thread];
+}
+
+size_t FrameArena::totalCapacity()
+{
+    // The frame arena and the thread arenas, not those owned elsewhere
+    size_t totalSize = frameArena().capacity();
+    QVector<FrameArena*>& arenas = threadArenas().arenas;
+
+    for ( int i=0 ; i<arenas.size() ; ++i )
+        totalSize += arenas[i]->capacity();
+
+    return totalSize;
+}
+
+unsigned int FrameArena::heapAllocations()
+{
+    return heapAllocationCount;
+}
+
+unsigned int FrameArena::frameHeapAllocations()
+{
+    return heapAllocationCount - frameStartHeapAllocationCount;
+}
+
+void FrameArena::addBlock( size_t minimumSize )
+{
+    size_t size = _blocks.isEmpty() ? minimumSize : std::max( minimumSize, 2 * _blocks.back().size );
+
+    if ( !_blocks.isEmpty() )
+        _previousBlocksUsage += _offset;
+
+    Block block;
+    block.data = static_cast<char*>( ::malloc( size ) );
+    block.size = size;
+    _blocks.append( block );
+    _offset = 0;
+
+#ifndef COUNT_HEAP_ALLOCATIONS
+    countHeapAllocation();
+#endif
+}
+
+void FrameArena::releaseBlocks()
+{
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+        ::free( _blocks[i].data );
+
+    _blocks.clear();
+}
@@ -0,0 +1,71 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <QVector>
+#include <cstddef>
+
+/* A bump allocator for data that only lives during the current frame. Memory is
+ * handed out linearly from a block and everything is released at once by
+ * 'reset'. When a frame needs more than one block, the blocks are merged into
+ * a single one on the next reset so that, once the steady state is reached,
+ * the arenas do not allocate anymore.
+ *
+ * There is one arena for the serial parts of a frame ( frameArena ) and one
+ * arena per OpenMP thread for the parallel phases ( threadArena ). 'newFrame'
+ * must be called once at the beginning of each frame, outside of any parallel
+ * region. Only plain data types ( float, unsigned int, QVector3D... ) should be
+ * allocated since no constructor or destructor is ever called.
+ *
+ * 'frameHeapAllocations' counts the heap allocations of the current frame, by
+ * the thread calling 'newFrame' and its OpenMP team. With glibc it counts every
+ * call to malloc, so whatever still allocates in the loop shows up; elsewhere
+ * only the blocks of the arenas.
+ */
+
+class FrameArena
+{
+public:
+    FrameArena( size_t initialCapacity = 64 * 1024 );
+    ~FrameArena();
+
+    void* allocate( size_t bytes );
+    void shrinkLast( void* pointer, size_t bytes );
+    void reset();
+
+    template <typename T>
+    T* allocate( size_t count )
+    {
+        return static_cast<T*>( allocate( count * sizeof( T ) ) );
+    }
+
+    size_t used() const;
+    size_t capacity() const;
+
+    static void newFrame();
+    static FrameArena& frameArena();
+    static FrameArena& threadArena();
+    static size_t totalCapacity();
+
+    static unsigned int heapAllocations();
+    static unsigned int frameHeapAllocations();
+
+private:
+    FrameArena( const FrameArena& );
+    FrameArena& operator=( const FrameArena& );
+
+    void addBlock( size_t minimumSize );
+    void releaseBlocks();
+
+private:
+    struct Block
+    {
+        char* data;
+        size_t size;
+    };
+
+    QVector<Block> _blocks;
+    size_t _offset;
+    size_t _previousBlocksUsage;
+};
+
+#endif // FRAMEARENA_H
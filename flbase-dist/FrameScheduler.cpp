@@ -0,0 +1,87 @@
+#include "FrameScheduler.h"
+
+namespace
+{
+    // Time between frames when idle, in milliseconds
+    static int idleInterval = 250;
+}
+
+FrameScheduler::FrameScheduler( QObject* parent )
+    : QObject( parent )
+    , _framePeriod( 0 )
+    , _nextFrameTime( 0 )
+    , _lastFrameTime( 0 )
+    , _isIdle( false )
+{
+    setTargetFrameRate( 60 );
+
+    _timer.setSingleShot( true );
+#if QT_VERSION >= 0x050000
+    _timer.setTimerType( Qt::PreciseTimer );
+#endif
+    connect( &_timer, SIGNAL( timeout() ), this, SLOT( onTimeout() ) );
+}
+
+void FrameScheduler::setTargetFrameRate( float framesPerSecond )
+{
+    _framePeriod = 1e9 / framesPerSecond;
+}
+
+void FrameScheduler::setIdle( bool isIdle )
+{
+    _isIdle = isIdle;
+
+    if ( !_isIdle )
+        requestFrame();
+}
+
+void FrameScheduler::requestFrame()
+{
+    if ( !_timer.isActive() )
+        return;
+
+    // As soon as the target frame rate allows it
+    qint64 now = _clock.nsecsElapsed();
+    qint64 frameTime = qMax( _lastFrameTime + _framePeriod, now );
+
+    if ( frameTime >= _nextFrameTime )
+        return;
+
+    _nextFrameTime = frameTime;
+    _timer.start( int( ( _nextFrameTime - now ) / 1000000 ) );
+}
+
+void FrameScheduler::start()
+{
+    _clock.start();
+    _nextFrameTime = 0;
+    _lastFrameTime = -_framePeriod;
+    _timer.start( 0 );
+}
+
+void FrameScheduler::onTimeout()
+{
+    _lastFrameTime = _clock.nsecsElapsed();
+    emit frame();
+    scheduleNextFrame();
+}
+
+void FrameScheduler::scheduleNextFrame()
+{
+    qint64 now = _clock.nsecsElapsed();
+
+    if ( _isIdle )
+    {
+        _nextFrameTime = now + qint64( idleInterval ) * 1000000;
+        _timer.start( idleInterval );
+        return;
+    }
+
+    _nextFrameTime += _framePeriod;
+
+    // Late, start again from now rather than rushing the missed frames
+    if ( _nextFrameTime < now )
+        _nextFrameTime = now;
+
+    _timer.start( int( ( _nextFrameTime - now ) / 1000000 ) );
+}
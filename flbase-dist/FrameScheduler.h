@@ -0,0 +1,51 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+/* Decides when the next frame is drawn, so the interface thread sleeps in the
+ * event loop between frames instead of spinning, and leaves the cores to the
+ * simulation threads.
+ *
+ * Frames are started by a timer at the target frame rate. A frame that ends
+ * late is not caught up on, which would only pile up frames behind a swap
+ * waiting for the vertical synchronization. When idle ( paused ) the frames
+ * are slowed down to a few per second, enough to show results of the surface
+ * thread, unless a frame is requested after an input. A requested frame is
+ * still drawn no sooner than one period after the last, so a stream of
+ * inputs such as a mouse drag does not exceed the target frame rate.
+ */
+
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameScheduler( QObject* parent = 0 );
+
+    void setTargetFrameRate( float framesPerSecond );
+    void setIdle( bool isIdle );
+    void requestFrame();
+    void start();
+
+signals:
+    void frame();
+
+private slots:
+    void onTimeout();
+
+private:
+    void scheduleNextFrame();
+
+private:
+    QTimer _timer;
+    QElapsedTimer _clock;
+    qint64 _framePeriod;     // In nanoseconds
+    qint64 _nextFrameTime;
+    qint64 _lastFrameTime;
+    bool _isIdle;
+};
+
+#endif // FRAMESCHEDULER_H
@@ -2,6 +2,21 @@
 #include "Geometry/Camera.h"
 #include <cmath>
 
+namespace
+{
+    // Whether the rotation and scale of two transformations are the same,
+    // and so their normal matrices
+    bool hasSameLinearPart( const QMatrix4x4& a, const QMatrix4x4& b )
+    {
+        for ( int i=0 ; i<3 ; ++i )
+            for ( int j=0 ; j<3 ; ++j )
+                if ( a( i, j ) != b( i, j ) )
+                    return false;
+
+        return true;
+    }
+}
+
 GLShader::GLShader()
     : _vertexLocation( 0 )
     , _normalLocation( 0 )
@@ -12,6 +27,8 @@ GLShader::GLShader()
     , _cameraPositionLocation( 0 )
     , _materialDiffuseLocation( 0 )
     , _materialRefractiveIndexLocation( 0 )
+    , _isGlobalTransformationSet( false )
+    , _isMaterialSet( false )
 {
 }
 
@@ -19,6 +36,7 @@ void GLShader::initialize()
 {
     _shader.addShaderFromSourceFile( QGLShader::Vertex,  ":/Shaders/Refraction.vs" );
     _shader.addShaderFromSourceFile( QGLShader::Fragment,  ":/Shaders/Refraction.fs" );
+    _shader.addShaderFromSourceFile( QGLShader::Fragment,  ":/Shaders/Fresnel.fs" );
     _shader.link();
 
     _vertexLocation = _shader.attributeLocation( "vertex" );
@@ -32,16 +50,32 @@ void GLShader::initialize()
     _materialDiffuseLocation = _shader.uniformLocation( "material.diffuse" );
     _materialEnableRefractionLocation = _shader.uniformLocation( "material.enableRefraction" );
     _materialRefractiveIndexLocation = _shader.uniformLocation( "material.refractiveIndex" );
+
+    _isGlobalTransformationSet = false;
+    _isMaterialSet = false;
 }
 
 void GLShader::setupCamera( const Camera& camera )
 {
+    _cameraTransformation = camera.globalTransformation();
+    _projectionMatrix = camera.projectionMatrix();
+
     QMatrix4x4 viewMatrix = camera.globalTransformation().inverted();
     _shader.setUniformValue( _viewProjectionMatrixLocation, camera.projectionMatrix() * viewMatrix );
     _shader.setUniformValue( _lightDirectionLocation, camera.globalTransformation().column(2).toVector3D() );
     _shader.setUniformValue( _cameraPositionLocation, camera.globalTransformation().column(3).toVector3D() );
 }
 
+const QMatrix4x4& GLShader::cameraTransformation() const
+{
+    return _cameraTransformation;
+}
+
+const QMatrix4x4& GLShader::projectionMatrix() const
+{
+    return _projectionMatrix;
+}
+
 void GLShader::bind()
 {
     _shader.bind();
@@ -89,17 +123,30 @@ void GLShader::disableNormalAttributeArray()
 
 void GLShader::setGlobalTransformation( const QMatrix4x4& globalTransformation )
 {
+    if ( _isGlobalTransformationSet && globalTransformation == _globalTransformation )
+        return;
+
     _shader.setUniformValue( _modelMatrixLocation, globalTransformation );
-    _shader.setUniformValue( _normalMatrixLocation, globalTransformation.normalMatrix() );
+
+    if ( !_isGlobalTransformationSet || !hasSameLinearPart( globalTransformation, _globalTransformation ) )
+        _shader.setUniformValue( _normalMatrixLocation, globalTransformation.normalMatrix() );
+
+    _globalTransformation = globalTransformation;
+    _isGlobalTransformationSet = true;
 }
 
 void GLShader::setMaterial( const Material& material )
 {
+    if ( _isMaterialSet && material == _material )
+        return;
+
     _shader.setUniformValue( _materialIsUsingCubemapLocation, material.isUsingCubemap() );
     _shader.setUniformValue( _materialDiffuseLocation, material.diffuse() );
     _shader.setUniformValue( _materialRefractiveIndexLocation, material.refractiveIndex() );
     _shader.setUniformValue( _materialEnableRefractionLocation, ( material.refractiveIndex() != 1 ) ? true : false );
 
+    _material = material;
+    _isMaterialSet = true;
 }
 
 void GLShader::release()
@@ -9,6 +9,10 @@ class Light;
 
 /* An uber shader that tries to do everything at the same thing.
  * It can morph into a diffuse, environment or refractive shader.
+ *
+ * The last transformation and material are kept, so setting the same values
+ * again uploads nothing, and moving an object without rotating or scaling it
+ * does not compute the normal matrix again.
  */
 
 class GLShader
@@ -18,6 +22,8 @@ public:
 
     void initialize();
     void setupCamera( const Camera& camera );
+    const QMatrix4x4& cameraTransformation() const;
+    const QMatrix4x4& projectionMatrix() const;
     void bind();
     void setVertexAttributeBuffer();
     void setNormalAttributeBuffer();
@@ -33,6 +39,8 @@ public:
 
 private:
     QGLShaderProgram _shader;
+    QMatrix4x4 _cameraTransformation;
+    QMatrix4x4 _projectionMatrix;
 
     // Locations
     unsigned int _vertexLocation;
@@ -46,6 +54,12 @@ private:
     unsigned int _materialDiffuseLocation;
     unsigned int _materialEnableRefractionLocation;
     unsigned int _materialRefractiveIndexLocation;
+
+    // Values of the uniforms in the program
+    QMatrix4x4 _globalTransformation;
+    Material _material;
+    bool _isGlobalTransformationSet;
+    bool _isMaterialSet;
 };
 
 #endif // GLSHADER_H
@@ -1,4 +1,7 @@
 #include "GLWidget.h"
+#include "FrameArena.h"
+#include "MemoryFootprint.h"
+#include "Profiler.h"
 #include <QKeyEvent>
 #include <QApplication>
 #include <cmath>
@@ -7,14 +10,56 @@
 #define GL_TEXTURE_CUBE_MAP_SEAMLESS 0x884F
 #endif
 
+namespace
+{
+    static float targetFrameRate = 60;
+
+    // Action of a key, or -1
+    int keyAction( int key )
+    {
+        switch ( key )
+        {
+        case Qt::Key_M : return InputScript::ChangeRenderMode;
+        case Qt::Key_A : return InputScript::ChangeSurfaceKernel;
+        case Qt::Key_O : return InputScript::ChangeSurfaceExtraction;
+        case Qt::Key_T : return InputScript::ChangeSurfaceThreading;
+        case Qt::Key_R : return InputScript::ChangeMaterial;
+        case Qt::Key_V : return InputScript::ChangeViscositySolver;
+        case Qt::Key_K : return InputScript::ChangeKernelFamily;
+        case Qt::Key_L : return InputScript::ChangeKernelTabulation;
+        case Qt::Key_B : return InputScript::ChangeLoadBalancing;
+        case Qt::Key_E : return InputScript::ChangeIntegrator;
+        case Qt::Key_0 : return InputScript::ResetVelocities;
+        case Qt::Key_P : return InputScript::Pause;
+        default : return -1;
+        }
+    }
+
+    QGLFormat glFormat()
+    {
+        QGLFormat format( QGL::DepthBuffer | QGL::DoubleBuffer );
+
+        // The swap waits for the display, the frame scheduler paces the rest
+        format.setSwapInterval( 1 );
+
+        return format;
+    }
+}
+
 GLWidget::GLWidget( QWidget* parent )
-    : QGLWidget( QGLFormat( QGL::DepthBuffer | QGL::DoubleBuffer ), parent )
+    : QGLWidget( glFormat(), parent )
     , _cubeMap( ":/Images/Checker/" )
     , _scene( 0 )
     , _paused( false )
     , _mouseButtons( Qt::NoButton )
     , _moveContainer( false )
+    , _showProfiler( false )
+    , _isRecording( false )
+    , _isReplaying( false )
 {
+    connect( &_frameScheduler, SIGNAL( frame() ), this, SLOT( updateGL() ) );
+    _frameScheduler.setTargetFrameRate( targetFrameRate );
+    _frameScheduler.start();
 }
 
 GLWidget::~GLWidget()
@@ -25,11 +70,34 @@ void GLWidget::setScene( Scene* scene )
 {
     _scene = scene;
     _scene->resizeViewport( size().width(), size().height() );
+    Profiler::profiler().reset();
+    MemoryFootprint::memoryFootprint().reset();
+    _frameScheduler.requestFrame();
+}
+
+void GLWidget::startRecording( const QString& sceneName )
+{
+    _recording = InputScript();
+    _recording.setSceneName( sceneName );
+    _isRecording = true;
+}
+
+const InputScript& GLWidget::recording() const
+{
+    return _recording;
+}
+
+void GLWidget::startReplay( const InputScript& script )
+{
+    _replay = script;
+    _replay.rewind();
+    _isReplaying = !_replay.isFinished();
+    _frameScheduler.setIdle( false );
 }
 
-void GLWidget::onIdle()
+bool GLWidget::isScripted() const
 {
-    updateGL();
+    return _isRecording || _isReplaying;
 }
 
 void GLWidget::initializeGL()
@@ -49,42 +117,95 @@ void GLWidget::resizeGL( int width, int height )
 {
     glViewport( 0, 0, width, height );
     _scene->resizeViewport( width, height );
+    _frameScheduler.requestFrame();
 }
 
 void GLWidget::paintGL()
 {
+    ProfilerScope profilerScope( Profiler::Frame );
+
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
+    // Everything allocated in the arenas during the last frame is released
+    FrameArena::newFrame();
+
     if ( _scene )
     {
-        _timeState.newFrame();
+        if ( _isReplaying )
+        {
+            _timeState.newFrame( _replay.replayFrame( *_scene, _paused ) );
+            _isReplaying = !_replay.isFinished();
+            _frameScheduler.setIdle( _paused && !_isReplaying );
+        }
+        else
+        {
+            _timeState.newFrame();
+        }
+
+        if ( _isRecording )
+            _recording.recordFrame( _timeState.deltaTime(), *_scene );
+
         _scene->update();
 
         if ( !_paused )
             _scene->animate( _timeState );
 
         _scene->update();
+
+        ProfilerScope renderScope( Profiler::Render );
         _shader.setupCamera( _scene->activeCamera() );
         _scene->render( _shader );
     }
+
+    Profiler::profiler().recordFrameAllocations( FrameArena::frameHeapAllocations() );
+
+    if ( _showProfiler )
+        renderProfiler();
+}
+
+void GLWidget::renderProfiler()
+{
+    QStringList lines = Profiler::profiler().report() + MemoryFootprint::memoryFootprint().report();
+    QFont font( "Monospace" );
+    font.setStyleHint( QFont::TypeWriter );
+
+    // The text is drawn by the fixed pipeline
+    _shader.release();
+    qglColor( Qt::black );
+
+    for ( int i=0 ; i<lines.size() ; ++i )
+        renderText( 10, 20 + 15 * i, lines[i], font );
+
+    _shader.bind();
 }
 
 void GLWidget::keyPressEvent( QKeyEvent* event )
 {
-    if ( event->key() == Qt::Key_M )
-        _scene->sph().changeRenderMode();
+    if ( event->key() == Qt::Key_I )
+        _showProfiler = !_showProfiler;
+
+    // The inputs would not be in the replayed script
+    if ( !_scene || _isReplaying )
+    {
+        _frameScheduler.requestFrame();
+        return;
+    }
+
+    int action = keyAction( event->key() );
 
-    if ( event->key() == Qt::Key_R )
-        _scene->sph().changeMaterial();
+    if ( action >= 0 )
+    {
+        InputScript::apply( InputScript::Action( action ), *_scene, _paused );
+        _frameScheduler.setIdle( _paused );
 
-    if ( event->key() == Qt::Key_0 )
-        _scene->sph().resetVelocities();
+        if ( _isRecording )
+            _recording.recordAction( InputScript::Action( action ) );
+    }
 
     if ( event->key() == Qt::Key_Space )
         _moveContainer = true;
 
-    if ( event->key() == Qt::Key_P )
-        _paused = !_paused;
+    _frameScheduler.requestFrame();
 }
 
 void GLWidget::keyReleaseEvent( QKeyEvent* /*event*/ )
@@ -106,7 +227,7 @@ void GLWidget::mouseReleaseEvent( QMouseEvent* event )
 
 void GLWidget::mouseMoveEvent( QMouseEvent* event )
 {
-    if ( _scene )
+    if ( _scene && !_isReplaying )
     {
         Camera& camera = _scene->activeCamera();
         SPH& sph = _scene->sph();
@@ -140,5 +261,8 @@ void GLWidget::mouseMoveEvent( QMouseEvent* event )
             QVector3D translation = cameraTransformation.column( 3 ).toVector3D();
             cameraTransformation.setColumn( 3, QVector4D( translation * ( 1 + delta.y() / 60.0 ), 1 ) );
         }
+
+        if ( _mouseButtons )
+            _frameScheduler.requestFrame();
     }
 }
@@ -3,7 +3,9 @@
 
 #include "Scenes/Scene.h"
 #include "CubeMap.h"
+#include "FrameScheduler.h"
 #include "GLShader.h"
+#include "InputScript.h"
 #include "TimeState.h"
 #include <QGLWidget>
 #include <QLabel>
@@ -22,7 +24,13 @@ public:
     virtual ~GLWidget();
 
     void setScene( Scene* scene );
-    void onIdle();
+
+    // The replay ignores the inputs until the end of the script. Neither
+    // allows another scene, a script holding the inputs of one.
+    void startRecording( const QString& sceneName );
+    const InputScript& recording() const;
+    void startReplay( const InputScript& script );
+    bool isScripted() const;
 
 public slots:
     virtual void paintGL();
@@ -36,6 +44,9 @@ protected:
     virtual void mouseReleaseEvent( QMouseEvent* event );
     virtual void mouseMoveEvent( QMouseEvent* event );
 
+private:
+    void renderProfiler();
+
 private:
     GLShader _shader;
     CubeMap _cubeMap;
@@ -45,6 +56,12 @@ private:
     Qt::MouseButtons _mouseButtons;
     QPoint _mousePosition;
     bool _moveContainer;
+    bool _showProfiler;
+    InputScript _recording;
+    InputScript _replay;
+    bool _isRecording;
+    bool _isReplaying;
+    FrameScheduler _frameScheduler;
 };
 
 #endif // GL_WIDGET_H
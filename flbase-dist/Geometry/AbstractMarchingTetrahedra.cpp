@@ -0,0 +1,243 @@
+#include "AbstractMarchingTetrahedra.h"
+#include <QtOpenGL>
+#include <cstring>
+
+AbstractMarchingTetrahedra::AbstractMarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ )
+    : _nbSamples( 0 )
+    , _nbTriangles( 0 )
+    , _boundingBox( boundingBox )
+    , _nbGLVertices( 0 )
+    , _glVertices( 0 )
+    , _glNormals( 0 )
+    , _arena( &FrameArena::frameArena() )
+    , _glCapacity( 3072 )
+{
+    QVector3D boxExtent = boundingBox.maximum() - boundingBox.minimum();
+
+    _nbCubes[0] = nbCubeX;
+    _nbCubes[1] = nbCubeY;
+    _nbCubes[2] = nbCubeZ;
+    _cubeSize[0] = boxExtent.x() / _nbCubes[0];
+    _cubeSize[1] = boxExtent.y() / _nbCubes[1];
+    _cubeSize[2] = boxExtent.z() / _nbCubes[2];
+}
+
+unsigned int AbstractMarchingTetrahedra::nbSamples() const
+{
+    return _nbSamples;
+}
+
+unsigned int AbstractMarchingTetrahedra::nbTriangles() const
+{
+    return _nbTriangles;
+}
+
+size_t AbstractMarchingTetrahedra::sampleMemoryUsage() const
+{
+    return _vertexValues.capacity() * sizeof( float ) +
+           ( _vertexNormals.capacity() + _vertexPositions.capacity() ) * sizeof( QVector3D );
+}
+
+void AbstractMarchingTetrahedra::renderTetrahedron( unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4 )
+{
+    ////////////////////////////////////////////////////
+    // IFT3355 - À compléter
+    //
+    // En utilisant les valeurs aux sommets, voyez dans
+    // quel cas de rendu vous vous trouvez. Faites appel
+    // à 'renderTriangle' ou 'renderQuad' dépendant du cas
+    // et réordonnancez les sommets pour que le (ou les)
+    // sommet de signe différent soit au début. Les noms
+    // de paramètres 'in' et 'out' ne sont que des indicateurs
+    // pour différencier les signes, et non un indicateur
+    // absolu de ce qui est à l'intérieur du liquide ou
+    // à l'extérieur.
+    ////////////////////////////////////////////////////
+
+    float value1 = _vertexValues[p1];
+    float value2 = _vertexValues[p2];
+    float value3 = _vertexValues[p3];
+    float value4 = _vertexValues[p4];
+
+    //Attribution des signes
+    int sign1 = ((value1 > 0) ? 1 : -1);
+    int sign2 = ((value2 > 0) ? 1 : -1);
+    int sign3 = ((value3 > 0) ? 1 : -1);
+    int sign4 = ((value4 > 0) ? 1 : -1);
+
+    //8 cas a evaluer avec la parite
+    //7 puisqu'on ne fait rien pour le cas trivial
+    //Evaluation de tous les cas possibles a traiter pour renderTriangle
+    if ((sign1 != sign2) && (sign1 != sign3) && (sign1 != sign4)) {
+        renderTriangle(p1, p2, p3, p4);
+        return;
+    }
+    if ((sign2 != sign1) && (sign2 != sign3) && (sign2 != sign4)) {
+        renderTriangle(p2, p1, p3, p4);
+        return;
+    }
+    if ((sign3 != sign1) && (sign3 != sign2) && (sign3 != sign4)) {
+        renderTriangle(p3, p1, p2, p4);
+        return;
+    }
+    if ((sign4 != sign1) && (sign4 != sign2) && (sign4 != sign3)) {
+        renderTriangle(p4, p1, p2, p3);
+        return;
+    }
+
+    // Evaluation de tous les cas possibles a traiter pour renderQuad
+    if ((sign1 == sign2) && (sign1 != sign3) && (sign1 != sign4)) {
+        renderQuad(p1, p2, p3, p4);
+        return;
+    }
+    if ((sign1 == sign3) && (sign1 != sign2) && (sign1 != sign4)) {
+        renderQuad(p1, p3, p2, p4);
+        return;
+    }
+    if ((sign1 == sign4) && (sign1 != sign2) && (sign1 != sign3)) {
+        renderQuad(p1, p4, p2, p3);
+        return;
+    }
+}
+
+void AbstractMarchingTetrahedra::renderTriangle( unsigned int in1, unsigned int out2, unsigned int out3, unsigned int out4 )
+{
+    ////////////////////////////////////////////////////
+    // IFT3355 - À compléter
+    //
+    // Calculez l'interpolation des valeurs et des normales
+    // pour les arêtes dont les sommets sont de signes
+    // différents. N'oubliez pas de normaliser vos normales.
+    //
+    // Le triangle n'est pas rendu tout de suite. Il vous
+    // faudra l'ajouter à la liste des triangles affichés
+    // en utilisant la méthode 'addTriangle'
+    ////////////////////////////////////////////////////
+
+    //Extraction des vecteurs position
+    QVector3D vec1 = _vertexPositions[in1];
+    QVector3D vec2 = _vertexPositions[out2];
+    QVector3D vec3 = _vertexPositions[out3];
+    QVector3D vec4 = _vertexPositions[out4];
+
+    //Extraction des normales
+    QVector3D vecn1 =  _vertexNormals[in1];
+    QVector3D vecn2 =  _vertexNormals[out2];
+    QVector3D vecn3 =  _vertexNormals[out3];
+    QVector3D vecn4 =  _vertexNormals[out4];
+
+    //Interpolation lineaire pour obtenir le triangle
+    QVector3D p0 = vec1 + (vec2 - vec1).normalized() * (vec2 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out2]-_vertexValues[in1]));
+    QVector3D p1 = vec1 + (vec3 - vec1).normalized() * (vec3 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
+    QVector3D p2 = vec1 + (vec4 - vec1).normalized() * (vec4 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
+
+    //Interpolation des normales
+    QVector3D n0 = vecn1 + (vecn2 - vecn1).normalized() * (vecn2 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out2]-_vertexValues[in1]));
+    QVector3D n1 = vecn1 + (vecn3 - vecn1).normalized() * (vecn3 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
+    QVector3D n2 = vecn1 + (vecn4 - vecn1).normalized() * (vecn4 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
+
+    //Normalisation des normales
+    n0.normalize();
+    n1.normalize();
+    n2.normalize();
+
+    //Ajout du triangle
+    addTriangle(p0, p1, p2, n0, n1, n2);
+}
+
+void AbstractMarchingTetrahedra::renderQuad( unsigned int in1, unsigned int in2, unsigned int out3, unsigned int out4 )
+{
+    ////////////////////////////////////////////////////
+    // IFT3355 - À compléter
+    //
+    // Calculer l'interpolation des valeurs et des normales
+    // pour les arêtes dont les sommets sont de signes
+    // différents. Vous aurez quatre sommets. Séparez le
+    // quadrilatère en deux triangles et les ajouter à
+    // la liste avec 'addTriangle'.
+    ////////////////////////////////////////////////////
+
+    //Extraction des vecteurs position
+    QVector3D vec1 = _vertexPositions[in1];
+    QVector3D vec2 = _vertexPositions[in2];
+    QVector3D vec3 = _vertexPositions[out3];
+    QVector3D vec4 = _vertexPositions[out4];
+
+    //Extraction des normales
+    QVector3D vecn1 = _vertexNormals[in1];
+    QVector3D vecn2 = _vertexNormals[in2];
+    QVector3D vecn3 = _vertexNormals[out3];
+    QVector3D vecn4 = _vertexNormals[out4];
+
+    //Interpolation lineaire pour obtenir le rectangle
+    QVector3D p0 = vec1 + (vec3 - vec1).normalized() * (vec3 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
+    QVector3D p1 = vec1 + (vec4 - vec1).normalized() * (vec4 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
+    QVector3D p2 = vec2 + (vec3 - vec2).normalized() * (vec3 - vec2).length() * (-_vertexValues[in2]/(_vertexValues[out3]-_vertexValues[in2]));
+    QVector3D p3 = vec2 + (vec4 - vec2).normalized() * (vec4 - vec2).length() * (-_vertexValues[in2]/(_vertexValues[out4]-_vertexValues[in2]));
+
+    //Interpolation des normales
+    QVector3D n0 = vecn1 + (vecn3 - vecn1).normalized() * (vecn3 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
+    QVector3D n1 = vecn1 + (vecn4 - vecn1).normalized() * (vecn4 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
+    QVector3D n2 = vecn2 + (vecn3 - vecn2).normalized() * (vecn3 - vecn2).length() * (-_vertexValues[in2]/(_vertexValues[out3]-_vertexValues[in2]));
+    QVector3D n3 = vecn2 + (vecn4 - vecn2).normalized() * (vecn4 - vecn2).length() * (-_vertexValues[in2]/(_vertexValues[out4]-_vertexValues[in2]));
+
+    //Normalisation des normales
+    n0.normalize();
+    n1.normalize();
+    n2.normalize();
+    n3.normalize();
+
+    //Ajout des triangles
+    addTriangle(p0, p1, p2, n0, n1, n2);
+    addTriangle(p1, p2, p3, n1, n2, n3);
+
+}
+
+void AbstractMarchingTetrahedra::beginTriangles( FrameArena& arena )
+{
+    // Gather triangles in the arena, sized after the largest mesh so far
+    _arena = &arena;
+    _nbGLVertices = 0;
+    _glVertices = arena.allocate<QVector3D>( _glCapacity );
+    _glNormals = arena.allocate<QVector3D>( _glCapacity );
+}
+
+void AbstractMarchingTetrahedra::renderTriangles( const QMatrix4x4& transformation, GLShader& shader )
+{
+    shader.setGlobalTransformation( transformation );
+
+    shader.enableVertexAttributeArray();
+    shader.enableNormalAttributeArray();
+    shader.setVertexAttributeArray( _glVertices );
+    shader.setNormalAttributeArray( _glNormals );
+
+    glDrawArrays( GL_TRIANGLES, 0, _nbGLVertices );
+    _nbTriangles = _nbGLVertices / 3;
+
+    shader.disableVertexAttributeArray();
+    shader.disableNormalAttributeArray();
+}
+
+void AbstractMarchingTetrahedra::addTriangle( const QVector3D& p0, const QVector3D& p1, const QVector3D& p2,
+                                      const QVector3D& n0, const QVector3D& n1, const QVector3D& n2 )
+{
+    if ( _nbGLVertices + 3 > _glCapacity )
+    {
+        QVector3D* vertices = _arena->allocate<QVector3D>( 2 * _glCapacity );
+        QVector3D* normals = _arena->allocate<QVector3D>( 2 * _glCapacity );
+        ::memcpy( vertices, _glVertices, _nbGLVertices * sizeof( QVector3D ) );
+        ::memcpy( normals, _glNormals, _nbGLVertices * sizeof( QVector3D ) );
+
+        _glVertices = vertices;
+        _glNormals = normals;
+        _glCapacity *= 2;
+    }
+
+    _glVertices[_nbGLVertices+0] = p0;
+    _glVertices[_nbGLVertices+1] = p1;
+    _glVertices[_nbGLVertices+2] = p2;
+    _glNormals[_nbGLVertices+0] = n0;
+    _glNormals[_nbGLVertices+1] = n1;
+    _glNormals[_nbGLVertices+2] = n2;
+    _nbGLVertices += 3;
+}
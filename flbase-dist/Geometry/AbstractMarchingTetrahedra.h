@@ -0,0 +1,63 @@
+#ifndef ABSTRACTMARCHINGTETRAHEDRA_H
+#define ABSTRACTMARCHINGTETRAHEDRA_H
+
+#include "Geometry/BoundingBox.h"
+#include "Geometry/ImplicitSurface.h"
+#include "FrameArena.h"
+#include "GLShader.h"
+#include <QVector>
+
+/* The part of the marching tetrahedra shared by the regular and the adaptive
+ * lattices: the samples of the implicit surface, and the triangles extracted
+ * from the tetrahedra joining them, gathered in a frame arena. Where the
+ * samples are taken, how the lattice is cut in tetrahedra and what happens to
+ * the triangles belong to the subclasses.
+ */
+
+class AbstractMarchingTetrahedra
+{
+public:
+    unsigned int nbSamples() const;
+    unsigned int nbTriangles() const;
+
+protected:
+    AbstractMarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ );
+
+    size_t sampleMemoryUsage() const;
+
+    void renderTetrahedron( unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4 );
+    void beginTriangles( FrameArena& arena = FrameArena::frameArena() );
+    void renderTriangles( const QMatrix4x4& transformation, GLShader& shader );
+
+private:
+    AbstractMarchingTetrahedra( const AbstractMarchingTetrahedra& );
+    AbstractMarchingTetrahedra& operator=( const AbstractMarchingTetrahedra& );
+
+    void renderTriangle( unsigned int in1, unsigned int out2, unsigned int out3, unsigned int out4 );
+    void renderQuad( unsigned int in1, unsigned int in2, unsigned int out3, unsigned int out4 );
+
+    void addTriangle( const QVector3D& p0, const QVector3D& p1, const QVector3D& p2,
+                      const QVector3D& n0, const QVector3D& n1, const QVector3D& n2 );
+
+protected:
+    QVector<float> _vertexValues;
+    QVector<QVector3D> _vertexNormals;
+    QVector<QVector3D> _vertexPositions;
+    unsigned int _nbSamples;
+    unsigned int _nbTriangles;
+
+    BoundingBox _boundingBox;
+    unsigned int _nbCubes[3];
+    float _cubeSize[3];
+
+    // Triangles gathered since 'beginTriangles'
+    int _nbGLVertices;
+    QVector3D* _glVertices;
+    QVector3D* _glNormals;
+
+private:
+    FrameArena* _arena;
+    int _glCapacity;
+};
+
+#endif // ABSTRACTMARCHINGTETRAHEDRA_H
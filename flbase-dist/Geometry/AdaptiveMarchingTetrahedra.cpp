@@ -0,0 +1,445 @@
+#include "AdaptiveMarchingTetrahedra.h"
+
+namespace
+{
+    // A cell crossed by the surface is subdivided when the normal of one of its
+    // samples deviates from the normal at its center by more than ~25 degrees
+    static float minNormalAgreement = 0.9;
+
+    static const quint64 emptyKey = ~quint64( 0 );
+
+    quint64 hashKey( quint64 key )
+    {
+        key ^= key >> 31;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 29;
+        return key;
+    }
+}
+
+AdaptiveMarchingTetrahedra::AdaptiveMarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ,
+                                                        unsigned int nbLevels )
+    : AbstractMarchingTetrahedra( boundingBox, nbCubeX, nbCubeY, nbCubeZ )
+    , _implicitSurface( 0 )
+    , _nbLevels( nbLevels )
+{
+    // Room for the coarse lattice, grown with the refined cells
+    unsigned int nbVertices = ( nbCubeX + 1 ) * ( nbCubeY + 1 ) * ( nbCubeZ + 1 );
+    _vertexValues.resize( nbVertices );
+    _vertexNormals.resize( nbVertices );
+    _vertexPositions.resize( nbVertices );
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        _unitSize[i] = _cubeSize[i] / cellSize( 0 );
+}
+
+void AdaptiveMarchingTetrahedra::render( const QMatrix4x4& transformation, GLShader& shader, ImplicitSurface& implicitSurface )
+{
+    _implicitSurface = &implicitSurface;
+    _nbSamples = 0;
+    _vertexTable.clear();
+    _cellTable.clear();
+    _cells.resize( 0 );
+
+    // Refine the coarse lattice where the surface needs it
+    for ( unsigned int z=0 ; z<_nbCubes[2] ; ++z )
+        for ( unsigned int y=0 ; y<_nbCubes[1] ; ++y )
+            for ( unsigned int x=0 ; x<_nbCubes[0] ; ++x )
+                buildCell( 0, x, y, z );
+
+    balance();
+
+    // Gather triangles
+    beginTriangles();
+
+    for ( int i=0 ; i<_cells.size() ; ++i )
+        if ( _cells[i].isLeaf )
+            renderCell( _cells[i] );
+
+    // Send it to OpenGL
+    renderTriangles( transformation, shader );
+}
+
+size_t AdaptiveMarchingTetrahedra::latticeMemoryUsage() const
+{
+    // The samples grow with the refined cells, in the arrays of the lattice
+    return sampleMemoryUsage() + _cells.capacity() * sizeof( Cell ) +
+           _cellTable.memoryUsage() + _vertexTable.memoryUsage();
+}
+
+void AdaptiveMarchingTetrahedra::buildCell( unsigned int level, unsigned int x, unsigned int y, unsigned int z )
+{
+    unsigned int size = cellSize( level );
+    unsigned int samples[9];
+
+    // Corners and center
+    for ( unsigned int i=0 ; i<8 ; ++i )
+        samples[i] = vertex( ( x + ( i & 1 ) ) * size, ( y + ( ( i >> 1 ) & 1 ) ) * size, ( z + ( i >> 2 ) ) * size );
+
+    samples[8] = vertex( x * size + size / 2, y * size + size / 2, z * size + size / 2 );
+
+    if ( level + 1 < _nbLevels && isDetailed( samples ) )
+    {
+        for ( unsigned int i=0 ; i<8 ; ++i )
+            buildCell( level + 1, 2 * x + ( i & 1 ), 2 * y + ( ( i >> 1 ) & 1 ), 2 * z + ( i >> 2 ) );
+    }
+    else
+    {
+        addLeaf( level, x, y, z );
+    }
+}
+
+bool AdaptiveMarchingTetrahedra::isDetailed( const unsigned int samples[9] ) const
+{
+    bool isCrossed = false;
+    bool isCurved = false;
+    const QVector3D& centerNormal = _vertexNormals[samples[8]];
+
+    for ( unsigned int i=0 ; i<8 ; ++i )
+    {
+        if ( ( _vertexValues[samples[i]] > 0 ) != ( _vertexValues[samples[8]] > 0 ) )
+            isCrossed = true;
+
+        // Samples out of reach of every particle have no normal
+        const QVector3D& normal = _vertexNormals[samples[i]];
+
+        if ( !normal.isNull() && !centerNormal.isNull() && QVector3D::dotProduct( normal, centerNormal ) < minNormalAgreement )
+            isCurved = true;
+    }
+
+    return isCrossed && isCurved;
+}
+
+void AdaptiveMarchingTetrahedra::addLeaf( unsigned int level, unsigned int x, unsigned int y, unsigned int z )
+{
+    Cell cell;
+    cell.level = level;
+    cell.x = x;
+    cell.y = y;
+    cell.z = z;
+    cell.isLeaf = true;
+
+    _cellTable.insert( cellKey( level, x, y, z ), _cells.size() );
+    _cells.append( cell );
+}
+
+void AdaptiveMarchingTetrahedra::splitLeaf( int index )
+{
+    Cell cell = _cells[index];
+    _cells[index].isLeaf = false;
+
+    unsigned int level = cell.level + 1;
+    unsigned int size = cellSize( level );
+
+    for ( unsigned int i=0 ; i<8 ; ++i )
+    {
+        unsigned int x = 2 * cell.x + ( i & 1 );
+        unsigned int y = 2 * cell.y + ( ( i >> 1 ) & 1 );
+        unsigned int z = 2 * cell.z + ( i >> 2 );
+
+        // Every vertex of the children is needed by the triangulation
+        for ( unsigned int j=0 ; j<8 ; ++j )
+            vertex( ( x + ( j & 1 ) ) * size, ( y + ( ( j >> 1 ) & 1 ) ) * size, ( z + ( j >> 2 ) ) * size );
+
+        addLeaf( level, x, y, z );
+    }
+}
+
+void AdaptiveMarchingTetrahedra::balance()
+{
+    // Leaves created by a split are appended and checked in turn
+    for ( int i=0 ; i<_cells.size() ; ++i )
+    {
+        if ( !_cells[i].isLeaf || _cells[i].level < 2 )
+            continue;
+
+        for ( int dz=-1 ; dz<=1 ; ++dz )
+        {
+            for ( int dy=-1 ; dy<=1 ; ++dy )
+            {
+                for ( int dx=-1 ; dx<=1 ; ++dx )
+                {
+                    const Cell& cell = _cells[i];
+                    unsigned int level = cell.level;
+                    int neighbor = findLeaf( level, cell.x + dx, cell.y + dy, cell.z + dz );
+
+                    // Split the neighbor until it is at most one level coarser
+                    while ( neighbor >= 0 && _cells[neighbor].level + 1 < level )
+                    {
+                        splitLeaf( neighbor );
+                        neighbor = findLeaf( level, _cells[i].x + dx, _cells[i].y + dy, _cells[i].z + dz );
+                    }
+                }
+            }
+        }
+    }
+}
+
+int AdaptiveMarchingTetrahedra::findLeaf( unsigned int level, int x, int y, int z ) const
+{
+    int nbCells = 1 << level;
+
+    if ( x < 0 || y < 0 || z < 0 ||
+         x >= (int)_nbCubes[0] * nbCells || y >= (int)_nbCubes[1] * nbCells || z >= (int)_nbCubes[2] * nbCells )
+        return -1;
+
+    // Leaf containing the cell, if it is not finer than the cell
+    for ( int l=level ; l>=0 ; --l )
+    {
+        unsigned int shift = level - l;
+        int index = _cellTable.find( cellKey( l, x >> shift, y >> shift, z >> shift ) );
+
+        if ( index >= 0 )
+            return _cells[index].isLeaf ? index : -1;
+    }
+
+    return -1;
+}
+
+void AdaptiveMarchingTetrahedra::renderCell( const Cell& cell )
+{
+    unsigned int size = cellSize( cell.level );
+    unsigned int origin[3] = { cell.x * size, cell.y * size, cell.z * size };
+
+    if ( !hasHangingVertices( origin, size ) )
+    {
+        renderCube( origin, size, ( cell.x + cell.y + cell.z ) & 1 );
+        return;
+    }
+
+    // Fan of tetrahedra around the center, one group per face
+    unsigned int apex = vertex( origin[0] + size / 2, origin[1] + size / 2, origin[2] + size / 2 );
+    int neighborCell[3] = { (int)cell.x, (int)cell.y, (int)cell.z };
+
+    for ( unsigned int axis=0 ; axis<3 ; ++axis )
+    {
+        for ( int side=0 ; side<2 ; ++side )
+        {
+            unsigned int faceOrigin[3] = { origin[0], origin[1], origin[2] };
+            faceOrigin[axis] += side * size;
+
+            // The face is split in four when the leaf across it is finer
+            int neighbor[3] = { neighborCell[0], neighborCell[1], neighborCell[2] };
+            neighbor[axis] += side ? 1 : -1;
+            bool isInside = neighbor[axis] >= 0 && neighbor[axis] < (int)( _nbCubes[axis] << cell.level );
+            bool isSubdivided = isInside && findLeaf( cell.level, neighbor[0], neighbor[1], neighbor[2] ) < 0;
+
+            renderFace( apex, faceOrigin, size, axis, isSubdivided );
+        }
+    }
+}
+
+void AdaptiveMarchingTetrahedra::renderCube( const unsigned int origin[3], unsigned int size, unsigned int parity )
+{
+    unsigned int corners[8];
+
+    for ( unsigned int i=0 ; i<8 ; ++i )
+        corners[i] = vertex( origin[0] + ( i & 1 ) * size, origin[1] + ( ( i >> 1 ) & 1 ) * size, origin[2] + ( i >> 2 ) * size );
+
+    // Five tetrahedra : the one joining the corners of even parity, and one
+    // per remaining corner. Every face is split through its even corners.
+    unsigned int central[4];
+    unsigned int nbCentral = 0;
+
+    for ( unsigned int i=0 ; i<8 ; ++i )
+    {
+        unsigned int cornerParity = ( parity + ( i & 1 ) + ( ( i >> 1 ) & 1 ) + ( i >> 2 ) ) & 1;
+
+        if ( cornerParity == 0 )
+            central[nbCentral++] = corners[i];
+        else
+            renderTetrahedron( corners[i], corners[i^1], corners[i^2], corners[i^4] );
+    }
+
+    renderTetrahedron( central[0], central[1], central[2], central[3] );
+}
+
+void AdaptiveMarchingTetrahedra::renderFace( unsigned int apex, const unsigned int origin[3], unsigned int size, unsigned int axis, bool isSubdivided )
+{
+    unsigned int u = ( axis + 1 ) % 3;
+    unsigned int v = ( axis + 2 ) % 3;
+
+    if ( isSubdivided )
+    {
+        for ( unsigned int i=0 ; i<4 ; ++i )
+        {
+            unsigned int quarterOrigin[3] = { origin[0], origin[1], origin[2] };
+            quarterOrigin[u] += ( i & 1 ) * size / 2;
+            quarterOrigin[v] += ( i >> 1 ) * size / 2;
+            renderFace( apex, quarterOrigin, size / 2, axis, false );
+        }
+
+        return;
+    }
+
+    const int cornerU[4] = { 0, 1, 1, 0 };
+    const int cornerV[4] = { 0, 0, 1, 1 };
+
+    // Corners in cyclic order, with the midpoints of the edges shared with finer leaves
+    unsigned int polygon[8];
+    unsigned int corners[4];
+    unsigned int nbVertices = 0;
+
+    for ( unsigned int i=0 ; i<4 ; ++i )
+    {
+        unsigned int position[3] = { origin[0], origin[1], origin[2] };
+        position[u] += cornerU[i] * size;
+        position[v] += cornerV[i] * size;
+
+        corners[i] = vertex( position[0], position[1], position[2] );
+        polygon[nbVertices++] = corners[i];
+
+        position[u] += ( cornerU[(i+1)%4] - cornerU[i] ) * (int)size / 2;
+        position[v] += ( cornerV[(i+1)%4] - cornerV[i] ) * (int)size / 2;
+        int midpoint = findVertex( position[0], position[1], position[2] );
+
+        if ( midpoint >= 0 )
+            polygon[nbVertices++] = midpoint;
+    }
+
+    if ( nbVertices == 4 )
+    {
+        // Split along the diagonal joining the corners of even parity, like renderCube
+        unsigned int first = ( ( ( origin[0] + origin[1] + origin[2] ) / size ) & 1 ) ? 1 : 0;
+
+        renderTetrahedron( apex, corners[first], corners[first+1], corners[first+2] );
+        renderTetrahedron( apex, corners[first], corners[first+2], corners[(first+3)%4] );
+    }
+    else
+    {
+        // Fan around the face center
+        unsigned int position[3] = { origin[0], origin[1], origin[2] };
+        position[u] += size / 2;
+        position[v] += size / 2;
+        unsigned int center = vertex( position[0], position[1], position[2] );
+
+        for ( unsigned int i=0 ; i<nbVertices ; ++i )
+            renderTetrahedron( apex, center, polygon[i], polygon[( i + 1 ) % nbVertices] );
+    }
+}
+
+bool AdaptiveMarchingTetrahedra::hasHangingVertices( const unsigned int origin[3], unsigned int size ) const
+{
+    // Midpoints of the twelve edges
+    for ( unsigned int axis=0 ; axis<3 ; ++axis )
+    {
+        unsigned int u = ( axis + 1 ) % 3;
+        unsigned int v = ( axis + 2 ) % 3;
+
+        for ( unsigned int i=0 ; i<4 ; ++i )
+        {
+            unsigned int position[3] = { origin[0], origin[1], origin[2] };
+            position[axis] += size / 2;
+            position[u] += ( i & 1 ) * size;
+            position[v] += ( i >> 1 ) * size;
+
+            if ( findVertex( position[0], position[1], position[2] ) >= 0 )
+                return true;
+        }
+    }
+
+    return false;
+}
+
+unsigned int AdaptiveMarchingTetrahedra::cellSize( unsigned int level ) const
+{
+    return 1 << ( _nbLevels - level );
+}
+
+unsigned int AdaptiveMarchingTetrahedra::vertex( unsigned int x, unsigned int y, unsigned int z )
+{
+    quint64 key = vertexKey( x, y, z );
+    int index = _vertexTable.find( key );
+
+    if ( index >= 0 )
+        return index;
+
+    if ( (int)_nbSamples == _vertexValues.size() )
+    {
+        _vertexValues.resize( 2 * _nbSamples );
+        _vertexNormals.resize( 2 * _nbSamples );
+        _vertexPositions.resize( 2 * _nbSamples );
+    }
+
+    index = _nbSamples++;
+    _vertexPositions[index] = _boundingBox.minimum() + QVector3D( x * _unitSize[0], y * _unitSize[1], z * _unitSize[2] );
+    _implicitSurface->surfaceInfo( _vertexPositions[index], _vertexValues[index], _vertexNormals[index] );
+    _vertexTable.insert( key, index );
+
+    return index;
+}
+
+int AdaptiveMarchingTetrahedra::findVertex( unsigned int x, unsigned int y, unsigned int z ) const
+{
+    return _vertexTable.find( vertexKey( x, y, z ) );
+}
+
+quint64 AdaptiveMarchingTetrahedra::vertexKey( unsigned int x, unsigned int y, unsigned int z )
+{
+    return ( quint64( x ) << 42 ) | ( quint64( y ) << 21 ) | quint64( z );
+}
+
+quint64 AdaptiveMarchingTetrahedra::cellKey( unsigned int level, unsigned int x, unsigned int y, unsigned int z )
+{
+    return ( quint64( level ) << 60 ) | ( quint64( x ) << 40 ) | ( quint64( y ) << 20 ) | quint64( z );
+}
+
+AdaptiveMarchingTetrahedra::KeyTable::KeyTable()
+    : _keys( 1024, emptyKey )
+    , _values( 1024 )
+    , _size( 0 )
+{
+}
+
+void AdaptiveMarchingTetrahedra::KeyTable::clear()
+{
+    _keys.fill( emptyKey );
+    _size = 0;
+}
+
+int AdaptiveMarchingTetrahedra::KeyTable::find( quint64 key ) const
+{
+    int mask = _keys.size() - 1;
+
+    for ( int i=hashKey( key ) & mask ; _keys[i] != emptyKey ; i=( i + 1 ) & mask )
+        if ( _keys[i] == key )
+            return _values[i];
+
+    return -1;
+}
+
+void AdaptiveMarchingTetrahedra::KeyTable::insert( quint64 key, int value )
+{
+    if ( 2 * ( _size + 1 ) > _keys.size() )
+        grow();
+
+    int mask = _keys.size() - 1;
+    int i = hashKey( key ) & mask;
+
+    while ( _keys[i] != emptyKey && _keys[i] != key )
+        i = ( i + 1 ) & mask;
+
+    if ( _keys[i] == emptyKey )
+        ++_size;
+
+    _keys[i] = key;
+    _values[i] = value;
+}
+
+size_t AdaptiveMarchingTetrahedra::KeyTable::memoryUsage() const
+{
+    return _keys.capacity() * sizeof( quint64 ) + _values.capacity() * sizeof( int );
+}
+
+void AdaptiveMarchingTetrahedra::KeyTable::grow()
+{
+    QVector<quint64> keys( 2 * _keys.size(), emptyKey );
+    QVector<int> values( 2 * _keys.size() );
+    keys.swap( _keys );
+    values.swap( _values );
+    _size = 0;
+
+    for ( int i=0 ; i<keys.size() ; ++i )
+        if ( keys[i] != emptyKey )
+            insert( keys[i], values[i] );
+}
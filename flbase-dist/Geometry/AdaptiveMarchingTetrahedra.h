@@ -0,0 +1,93 @@
+#ifndef ADAPTIVEMARCHINGTETRAHEDRA_H
+#define ADAPTIVEMARCHINGTETRAHEDRA_H
+
+#include "Geometry/AbstractMarchingTetrahedra.h"
+
+/* Marching tetrahedra over an octree instead of a regular lattice. Starting
+ * from a coarse lattice, a cell is subdivided only where the surface crosses
+ * it and the normals of its samples disagree, up to 'nbLevels' levels. The
+ * tree is then balanced so that neighboring leaves differ by one level at most.
+ *
+ * A leaf without finer neighbors is split in five tetrahedra, the others in
+ * tetrahedra joining their center to a triangulation of their faces. Every
+ * face is triangulated with the same rule from both sides ( diagonal through
+ * the corners of even parity, quarters when the other side is finer, fan
+ * around the center when edges carry hanging vertices ), so the mesh has no
+ * cracks.
+ *
+ * Vertices are addressed by integer coordinates in units of half the finest
+ * cube size, so that cell centers and face centers have integer coordinates.
+ * The samples are appended to the arrays of the lattice as they are needed,
+ * and the triangles drawn from the frame arena, without vertex buffers.
+ */
+
+class AdaptiveMarchingTetrahedra : public AbstractMarchingTetrahedra
+{
+public:
+    AdaptiveMarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ,
+                                unsigned int nbLevels );
+
+    void render( const QMatrix4x4& transformation, GLShader& shader, ImplicitSurface& implicitSurface );
+
+    size_t latticeMemoryUsage() const;
+
+private:
+    struct Cell
+    {
+        unsigned int level;
+        unsigned int x;
+        unsigned int y;
+        unsigned int z;
+        bool isLeaf;
+    };
+
+    // Open addressing hash table that keeps its memory from frame to frame
+    class KeyTable
+    {
+    public:
+        KeyTable();
+
+        void clear();
+        int find( quint64 key ) const;
+        void insert( quint64 key, int value );
+        size_t memoryUsage() const;
+
+    private:
+        void grow();
+
+    private:
+        QVector<quint64> _keys;
+        QVector<int> _values;
+        int _size;
+    };
+
+    void buildCell( unsigned int level, unsigned int x, unsigned int y, unsigned int z );
+    bool isDetailed( const unsigned int samples[9] ) const;
+    void addLeaf( unsigned int level, unsigned int x, unsigned int y, unsigned int z );
+    void splitLeaf( int cell );
+    void balance();
+    int findLeaf( unsigned int level, int x, int y, int z ) const;
+
+    void renderCell( const Cell& cell );
+    void renderCube( const unsigned int origin[3], unsigned int size, unsigned int parity );
+    void renderFace( unsigned int apex, const unsigned int origin[3], unsigned int size, unsigned int axis, bool isSubdivided );
+    bool hasHangingVertices( const unsigned int origin[3], unsigned int size ) const;
+
+    unsigned int cellSize( unsigned int level ) const;
+    unsigned int vertex( unsigned int x, unsigned int y, unsigned int z );
+    int findVertex( unsigned int x, unsigned int y, unsigned int z ) const;
+
+    static quint64 vertexKey( unsigned int x, unsigned int y, unsigned int z );
+    static quint64 cellKey( unsigned int level, unsigned int x, unsigned int y, unsigned int z );
+
+private:
+    ImplicitSurface* _implicitSurface;
+    unsigned int _nbLevels;
+    float _unitSize[3];
+
+    QVector<Cell> _cells;
+    KeyTable _cellTable;
+    KeyTable _vertexTable;
+};
+
+#endif // ADAPTIVEMARCHINGTETRAHEDRA_H
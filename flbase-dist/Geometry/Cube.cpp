@@ -180,6 +180,57 @@ bool Cube::intersectFacet( const Ray& ray, Intersection& intersection, unsigned
     return false;
 }
 
+// The same test as 'intersect' for a packet of rays. The six facets are
+// unrolled and the nearest one is kept with selects, so that the loop vectorizes
+void Cube::intersect( const RayBatch& rays, IntersectionBatch& intersections ) const
+{
+    unsigned int nbRays = rays.size();
+    intersections.resize( nbRays );
+
+    const float* origins[3] = { rays.origins( 0 ), rays.origins( 1 ), rays.origins( 2 ) };
+    const float* directions[3] = { rays.directions( 0 ), rays.directions( 1 ), rays.directions( 2 ) };
+    int* hits = intersections.hits();
+    float* ts = intersections.rayParameterTs();
+    float* positions[3] = { intersections.positions( 0 ), intersections.positions( 1 ), intersections.positions( 2 ) };
+    float* normals[3] = { intersections.normals( 0 ), intersections.normals( 1 ), intersections.normals( 2 ) };
+    float eps = 1e-6;
+    float noHit = std::numeric_limits<float>::max();
+
+#pragma omp simd
+    for ( unsigned int i=0 ; i<nbRays ; ++i )
+    {
+        float o[3] = { origins[0][i], origins[1][i], origins[2][i] };
+        float d[3] = { directions[0][i], directions[1][i], directions[2][i] };
+        float nearestT = noHit;
+        float normal[3] = { 0, 0, 0 };
+
+        for ( unsigned int coord=0 ; coord<3 ; ++coord )
+        {
+            for ( int sign=-1 ; sign<=1 ; sign+=2 )
+            {
+                float t = -( o[coord] - sign * side ) / d[coord];
+                float px = o[(coord+2)%3] + t * d[(coord+2)%3];
+                float pz = o[(coord+1)%3] + t * d[(coord+1)%3];
+                int isFacetHit = ( d[coord] != 0 ) & ( t >= 0 ) & ( t < nearestT ) &
+                                 ( px >= -side - eps ) & ( px <= side + eps ) &
+                                 ( pz >= -side - eps ) & ( pz <= side + eps );
+
+                nearestT = isFacetHit ? t : nearestT;
+                for ( unsigned int k=0 ; k<3 ; ++k )
+                    normal[k] = isFacetHit ? ( ( k == coord ) ? sign : 0 ) : normal[k];
+            }
+        }
+
+        hits[i] = ( nearestT < noHit );
+        ts[i] = nearestT;
+        for ( unsigned int k=0 ; k<3 ; ++k )
+        {
+            positions[k][i] = o[k] + nearestT * d[k];
+            normals[k][i] = normal[k];
+        }
+    }
+}
+
 float Cube::vectorCoord( const QVector3D& vector, unsigned int axis ) const
 {
     switch( axis )
@@ -193,6 +244,11 @@ float Cube::vectorCoord( const QVector3D& vector, unsigned int axis ) const
     return 0;
 }
 
+float Cube::distanceToBoundary( const QVector3D& point ) const
+{
+    return side - qMax( qMax( ::fabs( point.x() ), ::fabs( point.y() ) ), ::fabs( point.z() ) );
+}
+
 BoundingBox Cube::boundingBox() const
 {
     return BoundingBox( QVector3D( -0.5, -0.5, -0.5 ), QVector3D( 0.5, 0.5, 0.5 ) );
@@ -13,6 +13,8 @@ public:
     Cube( AbstractObject* parent, const Material& material );
 
     virtual bool intersect( const Ray& ray, Intersection& intersection ) const;
+    virtual void intersect( const RayBatch& rays, IntersectionBatch& intersections ) const;
+    virtual float distanceToBoundary( const QVector3D& point ) const;
     virtual BoundingBox boundingBox() const;
     virtual QVector3D randomInteriorPoint() const;
 
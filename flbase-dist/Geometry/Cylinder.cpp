@@ -190,6 +190,82 @@ bool Cylinder::intersect( const Ray& ray, Intersection& intersection ) const
     return false;
 }
 
+// The same test as above for a packet of rays, with selects instead of
+// branches so that the loop vectorizes
+void Cylinder::intersect( const RayBatch& rays, IntersectionBatch& intersections ) const
+{
+    unsigned int nbRays = rays.size();
+    intersections.resize( nbRays );
+
+    const float* ox = rays.origins( 0 );
+    const float* oy = rays.origins( 1 );
+    const float* oz = rays.origins( 2 );
+    const float* dx = rays.directions( 0 );
+    const float* dy = rays.directions( 1 );
+    const float* dz = rays.directions( 2 );
+    int* hits = intersections.hits();
+    float* ts = intersections.rayParameterTs();
+    float* px = intersections.positions( 0 );
+    float* py = intersections.positions( 1 );
+    float* pz = intersections.positions( 2 );
+    float* nx = intersections.normals( 0 );
+    float* ny = intersections.normals( 1 );
+    float* nz = intersections.normals( 2 );
+    float eps = 1e-4;
+    float noHit = std::numeric_limits<float>::max();
+
+#pragma omp simd
+    for ( unsigned int i=0 ; i<nbRays ; ++i )
+    {
+        // Contour
+        float a = dx[i] * dx[i] + dz[i] * dz[i];
+        float b = 2 * ( dx[i] * ox[i] + dz[i] * oz[i] );
+        float c = ox[i] * ox[i] + oz[i] * oz[i] - radius * radius;
+        float discriminant = b * b - 4 * a * c;
+        // In float, so the loop vectorizes. The hits may differ from those of
+        // the single ray version in the last bits.
+        float sqrtDiscriminant = std::sqrt( ( discriminant >= 0 ) ? discriminant : 0 );
+        float t1 = ( -b - sqrtDiscriminant ) / ( 2 * a );
+        float t2 = ( -b + sqrtDiscriminant ) / ( 2 * a );
+        float y1 = oy[i] + t1 * dy[i];
+        float y2 = oy[i] + t2 * dy[i];
+        int isHit1 = ( discriminant >= 0 ) & ( t1 >= -eps ) & ( y1 >= -side - eps ) & ( y1 <= side + eps );
+        int isHit2 = ( discriminant >= 0 ) & ( t2 >= -eps ) & ( y2 >= -side - eps ) & ( y2 <= side + eps );
+        float nearestT = isHit1 ? t1 : ( isHit2 ? t2 : noHit );
+        float capNormal = 0;
+
+        // Caps
+        for ( int sign=1 ; sign>=-1 ; sign-=2 )
+        {
+            float t = -( oy[i] - sign * side ) / dy[i];
+            float x = ox[i] + t * dx[i];
+            float z = oz[i] + t * dz[i];
+            int isCapHit = ( dy[i] != 0 ) & ( t >= 0 ) & ( t < nearestT ) &
+                           ( std::sqrt( x * x + z * z ) <= radius + eps );
+
+            nearestT = isCapHit ? t : nearestT;
+            capNormal = isCapHit ? sign : capNormal;
+        }
+
+        hits[i] = ( nearestT < noHit );
+        ts[i] = nearestT;
+        px[i] = ox[i] + nearestT * dx[i];
+        py[i] = oy[i] + nearestT * dy[i];
+        pz[i] = oz[i] + nearestT * dz[i];
+        nx[i] = ( capNormal != 0 ) ? 0 : px[i] / radius;
+        ny[i] = capNormal;
+        nz[i] = ( capNormal != 0 ) ? 0 : pz[i] / radius;
+    }
+}
+
+float Cylinder::distanceToBoundary( const QVector3D& point ) const
+{
+    float contour = radius - ::sqrt( point.x() * point.x() + point.z() * point.z() );
+    float caps = side - ::fabs( point.y() );
+
+    return qMin( contour, caps );
+}
+
 BoundingBox Cylinder::boundingBox() const
 {
     return BoundingBox( QVector3D( -radius, -side, -radius ), QVector3D( radius, side, radius ) );
@@ -6,10 +6,7 @@
 Geometry::Geometry( AbstractObject* parent, const Material& material )
     : AbstractObject( parent )
     , _material( material )
-    , _vertexBuffer( QGLBuffer::VertexBuffer )
-    , _normalBuffer( QGLBuffer::VertexBuffer )
-    , _indexBuffer( QGLBuffer::IndexBuffer )
-    , _nbIndices( 0 )
+    , _isMeshCreated( false )
 {
 }
 
@@ -22,28 +19,22 @@ void Geometry::render( GLShader& shader )
     shader.setGlobalTransformation( globalTransformation() );
     shader.setMaterial( _material );
 
-    if ( !_indexBuffer.isCreated() )
-        createOpenGLBuffers();
-
-    _vertexBuffer.bind();
-    shader.setVertexAttributeBuffer();
-    shader.enableVertexAttributeArray();
-    _vertexBuffer.release();
+    MeshPool& meshPool = MeshPool::meshPool();
 
-    if ( _normalBuffer.isCreated() )
+    if ( !_isMeshCreated )
     {
-        _normalBuffer.bind();
-        shader.setNormalAttributeBuffer();
-        shader.enableNormalAttributeArray();
-        _normalBuffer.release();
-    }
+        createOpenGLBuffers();
+        _mesh = meshPool.add( _vertices, _normals, _indices );
+        _isMeshCreated = true;
 
-    _indexBuffer.bind();
-    glDrawElements( GL_TRIANGLES, _nbIndices, GL_UNSIGNED_INT, 0 );
-    _indexBuffer.release();
+        _vertices.clear();
+        _normals.clear();
+        _indices.clear();
+    }
 
-    shader.disableVertexAttributeArray();
-    shader.disableNormalAttributeArray();
+    meshPool.bind( shader );
+    meshPool.draw( _mesh );
+    meshPool.release( shader );
 
     AbstractObject::render( shader );
 }
@@ -56,31 +47,44 @@ bool Geometry::intersect( const Ray& /*ray*/, Intersection& /*intersection*/ ) c
 
 void Geometry::createVertexBuffer( const QVector<QVector3D>& vertices )
 {
-    _vertexBuffer.create();
-    _vertexBuffer.bind();
-    _vertexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-    _vertexBuffer.allocate( &vertices[0], vertices.size() * sizeof( vertices[0] ) );
-    _vertexBuffer.release();
+    _vertices = vertices;
 }
 
 void Geometry::createNormalBuffer( const QVector<QVector3D>& normals )
 {
-    _normalBuffer.create();
-    _normalBuffer.bind();
-    _normalBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-    _normalBuffer.allocate( &normals[0], normals.size() * sizeof( normals[0] ) );
-    _normalBuffer.release();
+    _normals = normals;
 }
 
 void Geometry::createIndexBuffer( const QVector<unsigned int>& indices )
 {
-    _indexBuffer.create();
-    _indexBuffer.bind();
-    _indexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-    _indexBuffer.allocate( &indices[0], indices.size() * sizeof( indices[0] ) );
-    _indexBuffer.release();
+    _indices = indices;
+}
+
+void Geometry::intersect( const RayBatch& rays, IntersectionBatch& intersections ) const
+{
+    intersections.resize( rays.size() );
 
-    _nbIndices = indices.size();
+    for ( unsigned int i=0 ; i<rays.size() ; ++i )
+    {
+        Intersection intersection;
+
+        if ( intersect( rays.ray( i ), intersection ) )
+            intersections.setIntersection( i, intersection );
+        else
+            intersections.setMiss( i );
+    }
+}
+
+// Positive inside, negative outside. A geometry without an analytic distance
+// returns 0, so nothing is ever skipped.
+float Geometry::distanceToBoundary( const QVector3D& /*point*/ ) const
+{
+    return 0;
+}
+
+bool Geometry::contains( const QVector3D& point ) const
+{
+    return distanceToBoundary( point ) > 0;
 }
 
 const Material& Geometry::material() const
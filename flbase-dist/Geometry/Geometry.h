@@ -5,12 +5,18 @@
 #include "Geometry/AbstractObject.h"
 #include "Geometry/BoundingBox.h"
 #include "Geometry/Intersection.h"
-#include <QGLBuffer>
+#include "Geometry/IntersectionBatch.h"
+#include "Geometry/MeshPool.h"
+#include "Geometry/RayBatch.h"
 
 /* This is the parent class of every visual object in the scene. It contains
- * the material and OpenGL buffers.
+ * the material and its mesh in the shared MeshPool.
  *
  * It also requires derived class to implement an intersection test with a ray.
+ * The batched test falls back to it ray by ray, the analytic shapes override
+ * it with a vectorized loop that must give the same results.
+ * 'distanceToBoundary' lets a caller skip that test: a movement shorter than
+ * the distance from its start to the boundary cannot cross it.
  *
  */
 
@@ -22,12 +28,17 @@ public:
 
     virtual void render( GLShader& shader );
     virtual bool intersect( const Ray& ray, Intersection& intersection ) const;
+    virtual void intersect( const RayBatch& rays, IntersectionBatch& intersections ) const;
+    virtual float distanceToBoundary( const QVector3D& point ) const;
+    bool contains( const QVector3D& point ) const;
     virtual BoundingBox boundingBox() const=0;
     virtual QVector3D randomInteriorPoint() const=0;
 
     const Material& material() const;
 
 protected:
+    // The derived class gives its mesh through the 'create*Buffer' functions,
+    // which is then added to the mesh pool
     virtual void createOpenGLBuffers()=0;
     void createVertexBuffer( const QVector<QVector3D>& vertices );
     void createNormalBuffer( const QVector<QVector3D>& normals );
@@ -35,10 +46,13 @@ protected:
 
 private:
     Material _material;
-    QGLBuffer _vertexBuffer;
-    QGLBuffer _normalBuffer;
-    QGLBuffer _indexBuffer;
-    unsigned int _nbIndices;
+    MeshPool::Mesh _mesh;
+    bool _isMeshCreated;
+
+    // Only used while the mesh is created
+    QVector<QVector3D> _vertices;
+    QVector<QVector3D> _normals;
+    QVector<unsigned int> _indices;
 };
 
 #endif // GEOMETRY_H
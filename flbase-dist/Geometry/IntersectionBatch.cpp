@@ -0,0 +1,72 @@
+#include "IntersectionBatch.h"
+
+IntersectionBatch::IntersectionBatch()
+{
+}
+
+void IntersectionBatch::resize( unsigned int size )
+{
+    _hits.resize( size );
+    _rayParameterTs.resize( size );
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+    {
+        _positions[i].resize( size );
+        _normals[i].resize( size );
+    }
+}
+
+unsigned int IntersectionBatch::size() const
+{
+    return _hits.size();
+}
+
+bool IntersectionBatch::isHit( unsigned int i ) const
+{
+    return _hits[i] != 0;
+}
+
+Intersection IntersectionBatch::intersection( unsigned int i ) const
+{
+    return Intersection( QVector3D( _positions[0][i], _positions[1][i], _positions[2][i] ),
+                         QVector3D( _normals[0][i], _normals[1][i], _normals[2][i] ),
+                         _rayParameterTs[i] );
+}
+
+void IntersectionBatch::setIntersection( unsigned int i, const Intersection& intersection )
+{
+    _hits[i] = 1;
+    _rayParameterTs[i] = intersection.rayParameterT();
+
+    _positions[0][i] = intersection.position().x();
+    _positions[1][i] = intersection.position().y();
+    _positions[2][i] = intersection.position().z();
+    _normals[0][i] = intersection.normal().x();
+    _normals[1][i] = intersection.normal().y();
+    _normals[2][i] = intersection.normal().z();
+}
+
+void IntersectionBatch::setMiss( unsigned int i )
+{
+    _hits[i] = 0;
+}
+
+int* IntersectionBatch::hits()
+{
+    return _hits.data();
+}
+
+float* IntersectionBatch::rayParameterTs()
+{
+    return _rayParameterTs.data();
+}
+
+float* IntersectionBatch::positions( unsigned int coord )
+{
+    return _positions[coord].data();
+}
+
+float* IntersectionBatch::normals( unsigned int coord )
+{
+    return _normals[coord].data();
+}
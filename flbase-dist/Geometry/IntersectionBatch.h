@@ -0,0 +1,38 @@
+#ifndef INTERSECTIONBATCH_H
+#define INTERSECTIONBATCH_H
+
+#include "Geometry/Intersection.h"
+#include <QVector>
+
+/* The results of intersecting a RayBatch, as a structure of arrays indexed
+ * like the rays. The position, normal and 'rayParameterT' of a ray are only
+ * meaningful when 'isHit' is true.
+ */
+
+class IntersectionBatch
+{
+public:
+    IntersectionBatch();
+
+    void resize( unsigned int size );
+    unsigned int size() const;
+
+    bool isHit( unsigned int i ) const;
+    Intersection intersection( unsigned int i ) const;
+    void setIntersection( unsigned int i, const Intersection& intersection );
+    void setMiss( unsigned int i );
+
+    // Raw arrays written by the vectorized intersection loops
+    int* hits();
+    float* rayParameterTs();
+    float* positions( unsigned int coord );
+    float* normals( unsigned int coord );
+
+private:
+    QVector<int> _hits;
+    QVector<float> _rayParameterTs;
+    QVector<float> _positions[3];
+    QVector<float> _normals[3];
+};
+
+#endif // INTERSECTIONBATCH_H
@@ -1,25 +1,54 @@
 #include "MarchingTetrahedra.h"
+#include "FrameArena.h"
 #include <QtOpenGL>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-MarchingTetrahedra::MarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ )
-    : _boundingBox( boundingBox )
+namespace
 {
-    QVector3D boxExtent = boundingBox.maximum() - boundingBox.minimum();
-
-    _nbCubes[0] = nbCubeX;
-    _nbCubes[1] = nbCubeY;
-    _nbCubes[2] = nbCubeZ;
-    _cubeSize[0] = boxExtent.x() / _nbCubes[0];
-    _cubeSize[1] = boxExtent.y() / _nbCubes[1];
-    _cubeSize[2] = boxExtent.z() / _nbCubes[2];
+    // Number of cubes along each side of a block
+    static const unsigned int blockSize = 8;
+}
 
+MarchingTetrahedra::MarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ )
+    : AbstractMarchingTetrahedra( boundingBox, nbCubeX, nbCubeY, nbCubeZ )
+    , _frame( 0 )
+{
     // Allocate vertex value and position vector
     unsigned int nbCubes = ( nbCubeX + 1 ) * ( nbCubeY + 1 ) * ( nbCubeZ + 1 );
     _vertexValues.resize( nbCubes );
     _vertexNormals.resize( nbCubes );
     _vertexPositions.resize( nbCubes );
+    _vertexFrames.fill( 0, nbCubes );
 
     computeVertexPositions();
+
+    // Every block starts dirty
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        _nbBlocks[i] = ( _nbCubes[i] + blockSize - 1 ) / blockSize;
+
+    _blocks.resize( _nbBlocks[0] * _nbBlocks[1] * _nbBlocks[2] );
+
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+    {
+        Block& block = _blocks[i];
+        block.vertexBuffer = new QGLBuffer( QGLBuffer::VertexBuffer );
+        block.normalBuffer = new QGLBuffer( QGLBuffer::VertexBuffer );
+        block.nbVertices = 0;
+        block.isDirty = true;
+        block.isOutdated = true;
+        block.isUploaded = false;
+    }
+}
+
+MarchingTetrahedra::~MarchingTetrahedra()
+{
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+    {
+        delete _blocks[i].vertexBuffer;
+        delete _blocks[i].normalBuffer;
+    }
 }
 
 void MarchingTetrahedra::render( const QMatrix4x4& transformation, GLShader& shader, ImplicitSurface& implicitSurface )
@@ -39,19 +68,168 @@ void MarchingTetrahedra::render( const QMatrix4x4& transformation, GLShader& sha
     // z: _nbCubes[2]
     ////////////////////////////////////////////////////
 
-    computeVertexInfo(implicitSurface);
+    update( implicitSurface, FrameArena::frameArena() );
+    upload();
+    draw( transformation, shader );
+}
 
-    // Gather triangles
-    _nbGLVertices = 0;
+void MarchingTetrahedra::update( ImplicitSurface& implicitSurface, FrameArena& arena )
+{
+    _nbSamples = 0;
+    _nbTriangles = 0;
+    ++_frame;
+
+    // Triangle arrays shared by the blocks rebuilt this time
+    beginTriangles( arena );
+
+    // Sample the dirty blocks, then rebuild the blocks whose samples changed
+    unsigned int begin[3];
+    unsigned int end[3];
+
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+    {
+        if ( !_blocks[i].isDirty )
+            continue;
+
+        blockRange( i, begin, end );
+        computeVertexInfo( implicitSurface, begin, end );
+        _blocks[i].isDirty = false;
+    }
+
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+    {
+        Block& block = _blocks[i];
+
+        if ( block.isOutdated )
+        {
+            blockRange( i, begin, end );
+            remeshBlock( block, begin, end );
+        }
+
+        _nbTriangles += block.vertices.size() / 3;
+    }
+}
+
+void MarchingTetrahedra::upload()
+{
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+    {
+        Block& block = _blocks[i];
+
+        if ( block.isUploaded )
+            continue;
+
+        if ( !block.vertexBuffer->isCreated() )
+        {
+            block.vertexBuffer->create();
+            block.vertexBuffer->bind();
+            block.vertexBuffer->setUsagePattern( QGLBuffer::DynamicDraw );
+            block.normalBuffer->create();
+            block.normalBuffer->bind();
+            block.normalBuffer->setUsagePattern( QGLBuffer::DynamicDraw );
+        }
+
+        if ( !block.vertices.isEmpty() )
+        {
+            block.vertexBuffer->bind();
+            block.vertexBuffer->allocate( block.vertices.constData(), block.vertices.size() * sizeof( QVector3D ) );
+            block.normalBuffer->bind();
+            block.normalBuffer->allocate( block.normals.constData(), block.normals.size() * sizeof( QVector3D ) );
+            block.normalBuffer->release();
+        }
+
+        block.nbVertices = block.vertices.size();
+        block.isUploaded = true;
+    }
+}
+
+void MarchingTetrahedra::draw( const QMatrix4x4& transformation, GLShader& shader )
+{
+    shader.setGlobalTransformation( transformation );
+    shader.enableVertexAttributeArray();
+    shader.enableNormalAttributeArray();
+
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+    {
+        Block& block = _blocks[i];
+
+        if ( block.nbVertices == 0 )
+            continue;
+
+        block.vertexBuffer->bind();
+        shader.setVertexAttributeBuffer();
+        block.normalBuffer->bind();
+        shader.setNormalAttributeBuffer();
+        block.normalBuffer->release();
+
+        glDrawArrays( GL_TRIANGLES, 0, block.nbVertices );
+    }
+
+    shader.disableVertexAttributeArray();
+    shader.disableNormalAttributeArray();
+}
+
+void MarchingTetrahedra::invalidate( const BoundingBox& region )
+{
+    QVector3D minimum = region.minimum() - _boundingBox.minimum();
+    QVector3D maximum = region.maximum() - _boundingBox.minimum();
+    unsigned int blockBegin[3];
+    unsigned int blockEnd[3];
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+    {
+        // Cubes touching the lattice vertices inside the region
+        int cubeBegin = (int)::ceil( minimum[i] / _cubeSize[i] ) - 1;
+        int cubeEnd = (int)::floor( maximum[i] / _cubeSize[i] );
 
-    // Rendu de chacun des cubes (i.e. remplissage de la liste des triangles)
-    for ( unsigned int z=0 ; z<_nbCubes[2] ; ++z )
-        for ( unsigned int y=0 ; y<_nbCubes[1] ; ++y )
-            for ( unsigned int x=0 ; x<_nbCubes[0] ; ++x )
-                renderCube(x, y, z);
+        cubeBegin = std::max( cubeBegin, 0 );
+        cubeEnd = std::min( cubeEnd, (int)_nbCubes[i] - 1 );
 
-    // Send it to OpenGL
-    renderTriangles( transformation, shader );
+        if ( cubeBegin > cubeEnd )
+            return;
+
+        blockBegin[i] = cubeBegin / blockSize;
+        blockEnd[i] = cubeEnd / blockSize;
+    }
+
+    for ( unsigned int z=blockBegin[2] ; z<=blockEnd[2] ; ++z )
+        for ( unsigned int y=blockBegin[1] ; y<=blockEnd[1] ; ++y )
+            for ( unsigned int x=blockBegin[0] ; x<=blockEnd[0] ; ++x )
+                _blocks[( z * _nbBlocks[1] + y ) * _nbBlocks[0] + x].isDirty = true;
+}
+
+void MarchingTetrahedra::invalidateAll()
+{
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+        _blocks[i].isDirty = true;
+}
+
+size_t MarchingTetrahedra::latticeMemoryUsage() const
+{
+    return sampleMemoryUsage() +
+           _vertexFrames.capacity() * sizeof( unsigned int ) +
+           _blocks.capacity() * sizeof( Block );
+}
+
+size_t MarchingTetrahedra::meshMemoryUsage() const
+{
+    size_t bytes = 0;
+
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+        bytes += ( _blocks[i].vertices.capacity() + _blocks[i].normals.capacity() ) * sizeof( QVector3D );
+
+    return bytes;
+}
+
+size_t MarchingTetrahedra::bufferMemoryUsage() const
+{
+    size_t bytes = 0;
+
+    // A vertex and a normal for each vertex uploaded
+    for ( int i=0 ; i<_blocks.size() ; ++i )
+        bytes += _blocks[i].nbVertices * 2 * sizeof( QVector3D );
+
+    return bytes;
 }
 
 void MarchingTetrahedra::computeVertexPositions()
@@ -65,7 +243,19 @@ void MarchingTetrahedra::computeVertexPositions()
                 _vertexPositions[currentVertex] = vertexPosition( x, y, z );
 }
 
-void MarchingTetrahedra::computeVertexInfo( ImplicitSurface& implicitSurface )
+void MarchingTetrahedra::blockRange( unsigned int block, unsigned int begin[3], unsigned int end[3] ) const
+{
+    unsigned int blockPosition[3] = { block % _nbBlocks[0], ( block / _nbBlocks[0] ) % _nbBlocks[1], block / ( _nbBlocks[0] * _nbBlocks[1] ) };
+
+    // Cubes of the block
+    for ( unsigned int i=0 ; i<3 ; ++i )
+    {
+        begin[i] = blockPosition[i] * blockSize;
+        end[i] = std::min( begin[i] + blockSize, _nbCubes[i] );
+    }
+}
+
+void MarchingTetrahedra::computeVertexInfo( ImplicitSurface& implicitSurface, const unsigned int begin[3], const unsigned int end[3] )
 {
     ////////////////////////////////////////////////////
     // IFT3355 - À compléter
@@ -87,14 +277,75 @@ void MarchingTetrahedra::computeVertexInfo( ImplicitSurface& implicitSurface )
     // la fonction 'vertexIndex'.
     ////////////////////////////////////////////////////
 
-    for ( unsigned int z=0 ; z<_nbCubes[2]+1 ; ++z )
-        for ( unsigned int y=0 ; y<_nbCubes[1]+1 ; ++y )
-            for ( unsigned int x=0 ; x<_nbCubes[0]+1 ; ++x ) {
+    // Only the vertices of the block, skipping those already sampled by a
+    // neighbor block during this frame
+    for ( unsigned int z=begin[2] ; z<end[2]+1 ; ++z )
+        for ( unsigned int y=begin[1] ; y<end[1]+1 ; ++y )
+            for ( unsigned int x=begin[0] ; x<end[0]+1 ; ++x ) {
                 unsigned int index = vertexIndex(x, y, z);
-                implicitSurface.surfaceInfo(_vertexPositions[index], _vertexValues[index], _vertexNormals[index]);
+
+                if ( _vertexFrames[index] == _frame )
+                    continue;
+
+                float value;
+                QVector3D normal;
+                implicitSurface.surfaceInfo(_vertexPositions[index], value, normal);
+                _vertexFrames[index] = _frame;
+                ++_nbSamples;
+
+                if ( value != _vertexValues[index] || normal != _vertexNormals[index] ) {
+                    _vertexValues[index] = value;
+                    _vertexNormals[index] = normal;
+                    outdateBlocks(x, y, z);
+                }
             }
 }
 
+void MarchingTetrahedra::outdateBlocks( unsigned int x, unsigned int y, unsigned int z )
+{
+    unsigned int vertex[3] = { x, y, z };
+    unsigned int blockBegin[3];
+    unsigned int blockEnd[3];
+
+    // Blocks of the cubes around the vertex
+    for ( unsigned int i=0 ; i<3 ; ++i )
+    {
+        blockBegin[i] = ( vertex[i] > 0 ? vertex[i] - 1 : 0 ) / blockSize;
+        blockEnd[i] = std::min( vertex[i], _nbCubes[i] - 1 ) / blockSize;
+    }
+
+    for ( unsigned int bz=blockBegin[2] ; bz<=blockEnd[2] ; ++bz )
+        for ( unsigned int by=blockBegin[1] ; by<=blockEnd[1] ; ++by )
+            for ( unsigned int bx=blockBegin[0] ; bx<=blockEnd[0] ; ++bx )
+                _blocks[( bz * _nbBlocks[1] + by ) * _nbBlocks[0] + bx].isOutdated = true;
+}
+
+void MarchingTetrahedra::remeshBlock( Block& block, const unsigned int begin[3], const unsigned int end[3] )
+{
+    _nbGLVertices = 0;
+
+    for ( unsigned int cz=begin[2] ; cz<end[2] ; ++cz )
+        for ( unsigned int cy=begin[1] ; cy<end[1] ; ++cy )
+            for ( unsigned int cx=begin[0] ; cx<end[0] ; ++cx )
+                renderCube( cx, cy, cz );
+
+    // Keep the chunk until it is uploaded. The arrays only grow, by half
+    // again each time, and a reserved capacity is kept when they shrink, so
+    // remeshing a block mostly takes nothing from the heap.
+    if ( block.vertices.capacity() < _nbGLVertices )
+    {
+        block.vertices.reserve( _nbGLVertices + _nbGLVertices / 2 );
+        block.normals.reserve( _nbGLVertices + _nbGLVertices / 2 );
+    }
+
+    block.vertices.resize( _nbGLVertices );
+    block.normals.resize( _nbGLVertices );
+    ::memcpy( block.vertices.data(), _glVertices, _nbGLVertices * sizeof( QVector3D ) );
+    ::memcpy( block.normals.data(), _glNormals, _nbGLVertices * sizeof( QVector3D ) );
+    block.isOutdated = false;
+    block.isUploaded = false;
+}
+
 void MarchingTetrahedra::renderCube( unsigned int x, unsigned int y, unsigned int z )
 {
     ////////////////////////////////////////////////////
@@ -125,161 +376,6 @@ void MarchingTetrahedra::renderCube( unsigned int x, unsigned int y, unsigned in
     renderTetrahedron(ftl,ftr,rtl,fbr);
 }
 
-void MarchingTetrahedra::renderTetrahedron( unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4 )
-{
-    ////////////////////////////////////////////////////
-    // IFT3355 - À compléter
-    //
-    // En utilisant les valeurs aux sommets, voyez dans
-    // quel cas de rendu vous vous trouvez. Faites appel
-    // à 'renderTriangle' ou 'renderQuad' dépendant du cas
-    // et réordonnancez les sommets pour que le (ou les)
-    // sommet de signe différent soit au début. Les noms
-    // de paramètres 'in' et 'out' ne sont que des indicateurs
-    // pour différencier les signes, et non un indicateur
-    // absolu de ce qui est à l'intérieur du liquide ou
-    // à l'extérieur.
-    ////////////////////////////////////////////////////
-
-    float value1 = _vertexValues[p1];
-    float value2 = _vertexValues[p2];
-    float value3 = _vertexValues[p3];
-    float value4 = _vertexValues[p4];
-
-    //Attribution des signes
-    int sign1 = ((value1 > 0) ? 1 : -1);
-    int sign2 = ((value2 > 0) ? 1 : -1);
-    int sign3 = ((value3 > 0) ? 1 : -1);
-    int sign4 = ((value4 > 0) ? 1 : -1);
-
-    //8 cas a evaluer avec la parite
-    //7 puisqu'on ne fait rien pour le cas trivial
-    //Evaluation de tous les cas possibles a traiter pour renderTriangle
-    if ((sign1 != sign2) && (sign1 != sign3) && (sign1 != sign4)) {
-        renderTriangle(p1, p2, p3, p4);
-        return;
-    }
-    if ((sign2 != sign1) && (sign2 != sign3) && (sign2 != sign4)) {
-        renderTriangle(p2, p1, p3, p4);
-        return;
-    }
-    if ((sign3 != sign1) && (sign3 != sign2) && (sign3 != sign4)) {
-        renderTriangle(p3, p1, p2, p4);
-        return;
-    }
-    if ((sign4 != sign1) && (sign4 != sign2) && (sign4 != sign3)) {
-        renderTriangle(p4, p1, p2, p3);
-        return;
-    }
-
-    // Evaluation de tous les cas possibles a traiter pour renderQuad
-    if ((sign1 == sign2) && (sign1 != sign3) && (sign1 != sign4)) {
-        renderQuad(p1, p2, p3, p4);
-        return;
-    }
-    if ((sign1 == sign3) && (sign1 != sign2) && (sign1 != sign4)) {
-        renderQuad(p1, p3, p2, p4);
-        return;
-    }
-    if ((sign1 == sign4) && (sign1 != sign2) && (sign1 != sign3)) {
-        renderQuad(p1, p4, p2, p3);
-        return;
-    }
-}
-
-void MarchingTetrahedra::renderTriangle( unsigned int in1, unsigned int out2, unsigned int out3, unsigned int out4 )
-{
-    ////////////////////////////////////////////////////
-    // IFT3355 - À compléter
-    //
-    // Calculez l'interpolation des valeurs et des normales
-    // pour les arêtes dont les sommets sont de signes
-    // différents. N'oubliez pas de normaliser vos normales.
-    //
-    // Le triangle n'est pas rendu tout de suite. Il vous
-    // faudra l'ajouter à la liste des triangles affichés
-    // en utilisant la méthode 'addTriangle'
-    ////////////////////////////////////////////////////
-
-    //Extraction des vecteurs position
-    QVector3D vec1 = _vertexPositions[in1];
-    QVector3D vec2 = _vertexPositions[out2];
-    QVector3D vec3 = _vertexPositions[out3];
-    QVector3D vec4 = _vertexPositions[out4];
-
-    //Extraction des normales
-    QVector3D vecn1 =  _vertexNormals[in1];
-    QVector3D vecn2 =  _vertexNormals[out2];
-    QVector3D vecn3 =  _vertexNormals[out3];
-    QVector3D vecn4 =  _vertexNormals[out4];
-
-    //Interpolation lineaire pour obtenir le triangle
-    QVector3D p0 = vec1 + (vec2 - vec1).normalized() * (vec2 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out2]-_vertexValues[in1]));
-    QVector3D p1 = vec1 + (vec3 - vec1).normalized() * (vec3 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
-    QVector3D p2 = vec1 + (vec4 - vec1).normalized() * (vec4 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
-
-    //Interpolation des normales
-    QVector3D n0 = vecn1 + (vecn2 - vecn1).normalized() * (vecn2 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out2]-_vertexValues[in1]));
-    QVector3D n1 = vecn1 + (vecn3 - vecn1).normalized() * (vecn3 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
-    QVector3D n2 = vecn1 + (vecn4 - vecn1).normalized() * (vecn4 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
-
-    //Normalisation des normales
-    n0.normalize();
-    n1.normalize();
-    n2.normalize();
-
-    //Ajout du triangle
-    addTriangle(p0, p1, p2, n0, n1, n2);
-}
-
-void MarchingTetrahedra::renderQuad( unsigned int in1, unsigned int in2, unsigned int out3, unsigned int out4 )
-{
-    ////////////////////////////////////////////////////
-    // IFT3355 - À compléter
-    //
-    // Calculer l'interpolation des valeurs et des normales
-    // pour les arêtes dont les sommets sont de signes
-    // différents. Vous aurez quatre sommets. Séparez le
-    // quadrilatère en deux triangles et les ajouter à
-    // la liste avec 'addTriangle'.
-    ////////////////////////////////////////////////////
-
-    //Extraction des vecteurs position
-    QVector3D vec1 = _vertexPositions[in1];
-    QVector3D vec2 = _vertexPositions[in2];
-    QVector3D vec3 = _vertexPositions[out3];
-    QVector3D vec4 = _vertexPositions[out4];
-
-    //Extraction des normales
-    QVector3D vecn1 = _vertexNormals[in1];
-    QVector3D vecn2 = _vertexNormals[in2];
-    QVector3D vecn3 = _vertexNormals[out3];
-    QVector3D vecn4 = _vertexNormals[out4];
-
-    //Interpolation lineaire pour obtenir le rectangle
-    QVector3D p0 = vec1 + (vec3 - vec1).normalized() * (vec3 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
-    QVector3D p1 = vec1 + (vec4 - vec1).normalized() * (vec4 - vec1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
-    QVector3D p2 = vec2 + (vec3 - vec2).normalized() * (vec3 - vec2).length() * (-_vertexValues[in2]/(_vertexValues[out3]-_vertexValues[in2]));
-    QVector3D p3 = vec2 + (vec4 - vec2).normalized() * (vec4 - vec2).length() * (-_vertexValues[in2]/(_vertexValues[out4]-_vertexValues[in2]));
-
-    //Interpolation des normales
-    QVector3D n0 = vecn1 + (vecn3 - vecn1).normalized() * (vecn3 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out3]-_vertexValues[in1]));
-    QVector3D n1 = vecn1 + (vecn4 - vecn1).normalized() * (vecn4 - vecn1).length() * (-_vertexValues[in1]/(_vertexValues[out4]-_vertexValues[in1]));
-    QVector3D n2 = vecn2 + (vecn3 - vecn2).normalized() * (vecn3 - vecn2).length() * (-_vertexValues[in2]/(_vertexValues[out3]-_vertexValues[in2]));
-    QVector3D n3 = vecn2 + (vecn4 - vecn2).normalized() * (vecn4 - vecn2).length() * (-_vertexValues[in2]/(_vertexValues[out4]-_vertexValues[in2]));
-
-    //Normalisation des normales
-    n0.normalize();
-    n1.normalize();
-    n2.normalize();
-    n3.normalize();
-
-    //Ajout des triangles
-    addTriangle(p0, p1, p2, n0, n1, n2);
-    addTriangle(p1, p2, p3, n1, n2, n3);
-
-}
-
 QVector3D MarchingTetrahedra::vertexPosition( unsigned int x, unsigned int y, unsigned int z ) const
 {
     return _boundingBox.minimum() + QVector3D( x * _cubeSize[0], y * _cubeSize[1], z * _cubeSize[2] );
@@ -289,40 +385,3 @@ unsigned int MarchingTetrahedra::vertexIndex( unsigned int x, unsigned int y, un
 {
     return z * ( _nbCubes[0] + 1 ) * ( _nbCubes[1] + 1 ) + y * ( _nbCubes[0] + 1 ) + x;
 }
-
-void MarchingTetrahedra::addTriangle( const QVector3D& p0, const QVector3D& p1, const QVector3D& p2,
-                                      const QVector3D& n0, const QVector3D& n1, const QVector3D& n2 )
-{
-    if ( _glVertices.size() <= _nbGLVertices )
-    {
-        _glVertices.resize( _glVertices.size() + 192 );
-        _glNormals.resize( _glNormals.size() + 192 );
-    }
-
-    _glVertices[_nbGLVertices+0] = p0;
-    _glVertices[_nbGLVertices+1] = p1;
-    _glVertices[_nbGLVertices+2] = p2;
-    _glNormals[_nbGLVertices+0] = n0;
-    _glNormals[_nbGLVertices+1] = n1;
-    _glNormals[_nbGLVertices+2] = n2;
-    _nbGLVertices += 3;
-}
-
-void MarchingTetrahedra::renderTriangles( const QMatrix4x4& transformation, GLShader& shader )
-{
-    shader.setGlobalTransformation( transformation );
-
-    shader.enableVertexAttributeArray();
-    shader.enableNormalAttributeArray();
-    shader.setVertexAttributeArray( _glVertices.data() );
-    shader.setNormalAttributeArray( _glNormals.data() );
-
-    glDrawArrays( GL_TRIANGLES, 0, _nbGLVertices );
-
-    shader.disableVertexAttributeArray();
-    shader.disableNormalAttributeArray();
-}
-
-
-
-
@@ -1,50 +1,77 @@
 #ifndef MARCHINGTETRAHEDRA_H
 #define MARCHINGTETRAHEDRA_H
 
-#include "Geometry/BoundingBox.h"
-#include "Geometry/ImplicitSurface.h"
-#include "GLShader.h"
+#include "Geometry/AbstractMarchingTetrahedra.h"
 #include <QGLBuffer>
 
 /* Given an implicit surface, the marching tetrahedra algorithm will extract
  * a mesh representation of F(x)=0.
+ *
+ * The lattice is divided in blocks of cubes, each one keeping its part of the
+ * mesh in its own vertex buffers. A block is sampled again only after a region
+ * overlapping it has been invalidated, and triangulated again only when one of
+ * its samples changed, so the cost of the surface follows the activity of the
+ * fluid. Blocks sharing a changed sample are all rebuilt, which keeps the mesh
+ * free of cracks.
+ *
+ * 'render' does everything at once. Otherwise 'update' builds the mesh on the
+ * CPU and may run on another thread, while 'upload' and 'draw' need the OpenGL
+ * context and must not run during an update.
  */
 
-class MarchingTetrahedra
+class MarchingTetrahedra : public AbstractMarchingTetrahedra
 {
 public:
     MarchingTetrahedra( const BoundingBox& boundingBox, unsigned int nbCubeX, unsigned int nbCubeY, unsigned int nbCubeZ );
+    ~MarchingTetrahedra();
 
     void render( const QMatrix4x4& transformation, GLShader& shader, ImplicitSurface& implicitSurface );
+    void update( ImplicitSurface& implicitSurface, FrameArena& arena );
+    void upload();
+    void draw( const QMatrix4x4& transformation, GLShader& shader );
+    void invalidate( const BoundingBox& region );
+    void invalidateAll();
+
+    // Bytes of the samples, of the triangles kept by the blocks and of the
+    // vertex buffers. The first two must not be read during an update.
+    size_t latticeMemoryUsage() const;
+    size_t meshMemoryUsage() const;
+    size_t bufferMemoryUsage() const;
 
 private:
+    MarchingTetrahedra( const MarchingTetrahedra& );
+    MarchingTetrahedra& operator=( const MarchingTetrahedra& );
+
+    // The buffers of a block are its own. A copied QGLBuffer shares the
+    // buffer of the original, hence the pointers.
+    struct Block
+    {
+        QVector<QVector3D> vertices;
+        QVector<QVector3D> normals;
+        QGLBuffer* vertexBuffer;
+        QGLBuffer* normalBuffer;
+        int nbVertices;  // In the buffers
+        bool isDirty;    // The samples must be computed again
+        bool isOutdated; // The triangles must be computed again
+        bool isUploaded; // The buffers hold the triangles
+    };
+
     void computeVertexPositions();
 
-    void computeVertexInfo( ImplicitSurface& implicitSurface );
+    void blockRange( unsigned int block, unsigned int begin[3], unsigned int end[3] ) const;
+    void computeVertexInfo( ImplicitSurface& implicitSurface, const unsigned int begin[3], const unsigned int end[3] );
+    void outdateBlocks( unsigned int x, unsigned int y, unsigned int z );
+    void remeshBlock( Block& block, const unsigned int begin[3], const unsigned int end[3] );
     void renderCube( unsigned int x, unsigned int y, unsigned int z );
-    void renderTetrahedron( unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4 );
-    void renderTriangle( unsigned int in1, unsigned int out2, unsigned int out3, unsigned int out4 );
-    void renderQuad( unsigned int in1, unsigned int in2, unsigned int out3, unsigned int out4 );
     QVector3D vertexPosition( unsigned int x, unsigned int y, unsigned int z ) const;
     unsigned int vertexIndex( unsigned int x, unsigned int y, unsigned int z ) const;
 
-    void addTriangle( const QVector3D& p0, const QVector3D& p1, const QVector3D& p2,
-                      const QVector3D& n0, const QVector3D& n1, const QVector3D& n2 );
-    void renderTriangles( const QMatrix4x4& transformation, GLShader& shader );
-
 private:
-    QVector<float> _vertexValues;
-    QVector<QVector3D> _vertexNormals;
-    QVector<QVector3D> _vertexPositions;
-
-    BoundingBox _boundingBox;
-    unsigned int _nbCubes[3];
-    float _cubeSize[3];
-
-    // Rendering stuff
-    int _nbGLVertices;
-    QVector<QVector3D> _glVertices;
-    QVector<QVector3D> _glNormals;
+    // Blocks of cubes, and the frame each vertex was last sampled
+    QVector<Block> _blocks;
+    unsigned int _nbBlocks[3];
+    QVector<unsigned int> _vertexFrames;
+    unsigned int _frame;
 };
 
 
@@ -0,0 +1,161 @@
+#include "MeshPool.h"
+#include <QtOpenGL>
+
+MeshPool::MeshPool()
+    : _vertexBuffer( QGLBuffer::VertexBuffer )
+    , _normalBuffer( QGLBuffer::VertexBuffer )
+    , _indexBuffer( QGLBuffer::IndexBuffer )
+    , _isUploaded( false )
+    , _vertexArray( 0 )
+    , _isVertexArraySetup( false )
+    , _genVertexArrays( 0 )
+    , _bindVertexArray( 0 )
+{
+}
+
+MeshPool::Mesh MeshPool::add( const QVector<QVector3D>& vertices, const QVector<QVector3D>& normals, const QVector<unsigned int>& indices )
+{
+    // One normal per vertex, or the normal buffer would be read out of bounds
+    Q_ASSERT( normals.size() == vertices.size() );
+
+    if ( normals.size() != vertices.size() )
+    {
+        qWarning() << "Cannot add a mesh of" << vertices.size() << "vertices and" << normals.size() << "normals";
+        return Mesh();
+    }
+
+    // Same mesh as an existing one ?
+    for ( int i=0 ; i<_meshes.size() ; ++i )
+    {
+        const Mesh& mesh = _meshes[i];
+        unsigned int firstVertex = _meshFirstVertices[i];
+        unsigned int nbVertices = ( ( i + 1 < _meshes.size() ) ? _meshFirstVertices[i+1] : _vertices.size() ) - firstVertex;
+        bool isSame = ( mesh.nbIndices == (unsigned int)indices.size() && nbVertices == (unsigned int)vertices.size() );
+
+        for ( unsigned int j=0 ; isSame && j<nbVertices ; ++j )
+            isSame = ( _vertices[ firstVertex + j ] == vertices[j] && _normals[ firstVertex + j ] == normals[j] );
+
+        for ( unsigned int j=0 ; isSame && j<mesh.nbIndices ; ++j )
+            isSame = ( _indices[ mesh.firstIndex + j ] == indices[j] + firstVertex );
+
+        if ( isSame )
+            return mesh;
+    }
+
+    Mesh mesh;
+    unsigned int firstVertex = _vertices.size();
+    mesh.firstIndex = _indices.size();
+    mesh.nbIndices = indices.size();
+
+    _vertices += vertices;
+    _normals += normals;
+
+    for ( int i=0 ; i<indices.size() ; ++i )
+        _indices.append( indices[i] + firstVertex );
+
+    _meshes.append( mesh );
+    _meshFirstVertices.append( firstVertex );
+    _isUploaded = false;
+
+    return mesh;
+}
+
+void MeshPool::bind( GLShader& shader )
+{
+    if ( !_isUploaded )
+        upload();
+
+    if ( _bindVertexArray )
+    {
+        _bindVertexArray( _vertexArray );
+
+        if ( !_isVertexArraySetup )
+        {
+            setupAttributes( shader );
+            _isVertexArraySetup = true;
+        }
+    }
+    else
+    {
+        setupAttributes( shader );
+    }
+}
+
+void MeshPool::draw( const Mesh& mesh )
+{
+    glDrawElements( GL_TRIANGLES, mesh.nbIndices, GL_UNSIGNED_INT, (const GLvoid*)( mesh.firstIndex * sizeof( unsigned int ) ) );
+}
+
+void MeshPool::release( GLShader& shader )
+{
+    if ( _bindVertexArray )
+    {
+        _bindVertexArray( 0 );
+    }
+    else
+    {
+        _indexBuffer.release();
+        shader.disableVertexAttributeArray();
+        shader.disableNormalAttributeArray();
+    }
+}
+
+MeshPool& MeshPool::meshPool()
+{
+    static MeshPool meshPool;
+    return meshPool;
+}
+
+void MeshPool::upload()
+{
+    if ( !_vertexBuffer.isCreated() )
+    {
+        const QGLContext* context = QGLContext::currentContext();
+        _genVertexArrays = (GenVertexArrays)context->getProcAddress( "glGenVertexArrays" );
+        _bindVertexArray = (BindVertexArray)context->getProcAddress( "glBindVertexArray" );
+
+        // The vertex array is freed with the context
+        if ( _genVertexArrays && _bindVertexArray )
+            _genVertexArrays( 1, &_vertexArray );
+        else
+            _bindVertexArray = 0;
+
+        _vertexBuffer.create();
+        _normalBuffer.create();
+        _indexBuffer.create();
+    }
+
+    // The buffers keep their names, so the vertex array stays valid
+    _vertexBuffer.bind();
+    _vertexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
+    _vertexBuffer.allocate( _vertices.constData(), _vertices.size() * sizeof( QVector3D ) );
+    _vertexBuffer.release();
+
+    _normalBuffer.bind();
+    _normalBuffer.setUsagePattern( QGLBuffer::StaticDraw );
+    _normalBuffer.allocate( _normals.constData(), _normals.size() * sizeof( QVector3D ) );
+    _normalBuffer.release();
+
+    _indexBuffer.bind();
+    _indexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
+    _indexBuffer.allocate( _indices.constData(), _indices.size() * sizeof( unsigned int ) );
+    _indexBuffer.release();
+
+    _isUploaded = true;
+}
+
+void MeshPool::setupAttributes( GLShader& shader )
+{
+    _vertexBuffer.bind();
+    shader.setVertexAttributeBuffer();
+    shader.enableVertexAttributeArray();
+    _vertexBuffer.release();
+
+    _normalBuffer.bind();
+    shader.setNormalAttributeBuffer();
+    shader.enableNormalAttributeArray();
+    _normalBuffer.release();
+
+    // Part of the vertex array state, so it stays bound
+    _indexBuffer.bind();
+}
@@ -0,0 +1,72 @@
+#ifndef MESHPOOL_H
+#define MESHPOOL_H
+
+#include "GLShader.h"
+#include <QGLBuffer>
+#include <QVector>
+#include <QVector3D>
+
+/* Every static mesh ( containers, sky, particle spheres ) lives in one shared
+ * set of vertex, normal and index buffers, whose attribute setup is recorded
+ * once in a vertex array object. Drawing a mesh is then a bind of that object
+ * and a draw of its range of the index buffer, instead of binding three
+ * buffers and specifying the attributes again for each draw.
+ *
+ * The indices of a mesh are shifted by its first vertex when it is added, and
+ * adding a mesh equal to one already in the pool returns the existing one, so
+ * the sky and a cubic container share their vertices. A mesh without one
+ * normal per vertex is refused, and its empty range draws nothing. Without
+ * vertex array objects ( OpenGL < 3.0 without ARB_vertex_array_object ) the
+ * attributes are specified at each bind.
+ */
+
+class MeshPool
+{
+public:
+    struct Mesh
+    {
+        Mesh() : firstIndex( 0 ), nbIndices( 0 ) {}
+
+        unsigned int firstIndex;
+        unsigned int nbIndices;
+    };
+
+    MeshPool();
+
+    Mesh add( const QVector<QVector3D>& vertices, const QVector<QVector3D>& normals, const QVector<unsigned int>& indices );
+    void bind( GLShader& shader );
+    void draw( const Mesh& mesh );
+    void release( GLShader& shader );
+
+    static MeshPool& meshPool();
+
+private:
+    MeshPool( const MeshPool& );
+    MeshPool& operator=( const MeshPool& );
+
+    void upload();
+    void setupAttributes( GLShader& shader );
+
+private:
+    typedef void ( APIENTRY *GenVertexArrays )( GLsizei, GLuint* );
+    typedef void ( APIENTRY *BindVertexArray )( GLuint );
+
+    // Copies of the buffers, to upload them again when a mesh is added
+    QVector<QVector3D> _vertices;
+    QVector<QVector3D> _normals;
+    QVector<unsigned int> _indices;
+    QVector<Mesh> _meshes;
+    QVector<unsigned int> _meshFirstVertices;
+
+    QGLBuffer _vertexBuffer;
+    QGLBuffer _normalBuffer;
+    QGLBuffer _indexBuffer;
+    bool _isUploaded;
+
+    GLuint _vertexArray;
+    bool _isVertexArraySetup;
+    GenVertexArrays _genVertexArrays;
+    BindVertexArray _bindVertexArray;
+};
+
+#endif // MESHPOOL_H
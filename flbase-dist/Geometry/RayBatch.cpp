@@ -0,0 +1,46 @@
+#include "RayBatch.h"
+
+RayBatch::RayBatch()
+{
+}
+
+void RayBatch::clear()
+{
+    // Keeps the capacity, the batch is refilled every frame
+    for ( unsigned int i=0 ; i<3 ; ++i )
+    {
+        _origins[i].resize( 0 );
+        _directions[i].resize( 0 );
+    }
+}
+
+void RayBatch::append( const Ray& ray )
+{
+    _origins[0].append( ray.origin().x() );
+    _origins[1].append( ray.origin().y() );
+    _origins[2].append( ray.origin().z() );
+    _directions[0].append( ray.direction().x() );
+    _directions[1].append( ray.direction().y() );
+    _directions[2].append( ray.direction().z() );
+}
+
+unsigned int RayBatch::size() const
+{
+    return _origins[0].size();
+}
+
+Ray RayBatch::ray( unsigned int i ) const
+{
+    return Ray( QVector3D( _origins[0][i], _origins[1][i], _origins[2][i] ),
+                QVector3D( _directions[0][i], _directions[1][i], _directions[2][i] ) );
+}
+
+const float* RayBatch::origins( unsigned int coord ) const
+{
+    return _origins[coord].constData();
+}
+
+const float* RayBatch::directions( unsigned int coord ) const
+{
+    return _directions[coord].constData();
+}
@@ -0,0 +1,31 @@
+#ifndef RAYBATCH_H
+#define RAYBATCH_H
+
+#include "Geometry/Ray.h"
+#include <QVector>
+
+/* A packet of rays stored as a structure of arrays, one array per coordinate
+ * of the origins and of the directions, so that a geometry can intersect all
+ * of them in a single vectorizable loop.
+ */
+
+class RayBatch
+{
+public:
+    RayBatch();
+
+    void clear();
+    void append( const Ray& ray );
+
+    unsigned int size() const;
+    Ray ray( unsigned int i ) const;
+
+    const float* origins( unsigned int coord ) const;
+    const float* directions( unsigned int coord ) const;
+
+private:
+    QVector<float> _origins[3];
+    QVector<float> _directions[3];
+};
+
+#endif // RAYBATCH_H
@@ -129,6 +129,54 @@ bool Sphere::intersect( const Ray& ray, Intersection& intersection ) const
     return false;
 }
 
+// The same test as above for a packet of rays, with selects instead of branches
+// so that the loop vectorizes
+void Sphere::intersect( const RayBatch& rays, IntersectionBatch& intersections ) const
+{
+    unsigned int nbRays = rays.size();
+    intersections.resize( nbRays );
+
+    const float* ox = rays.origins( 0 );
+    const float* oy = rays.origins( 1 );
+    const float* oz = rays.origins( 2 );
+    const float* dx = rays.directions( 0 );
+    const float* dy = rays.directions( 1 );
+    const float* dz = rays.directions( 2 );
+    int* hits = intersections.hits();
+    float* ts = intersections.rayParameterTs();
+    float* px = intersections.positions( 0 );
+    float* py = intersections.positions( 1 );
+    float* pz = intersections.positions( 2 );
+    float* nx = intersections.normals( 0 );
+    float* ny = intersections.normals( 1 );
+    float* nz = intersections.normals( 2 );
+    float epsilon = 1e-3;
+
+#pragma omp simd
+    for ( unsigned int i=0 ; i<nbRays ; ++i )
+    {
+        float a = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i];
+        float b = 2 * ( dx[i] * ox[i] + dy[i] * oy[i] + dz[i] * oz[i] );
+        float c = ox[i] * ox[i] + oy[i] * oy[i] + oz[i] * oz[i] - radius * radius;
+        float discriminant = b * b - 4 * a * c;
+        float sqrtDiscriminant = sqrt( ( discriminant >= 0 ) ? discriminant : 0 );
+        float t1 = ( -b - sqrtDiscriminant ) / ( 2 * a );
+        float t2 = ( -b + sqrtDiscriminant ) / ( 2 * a );
+        float t = ( t1 >= -epsilon ) ? t1 : t2;
+
+        hits[i] = ( discriminant >= 0 ) & ( t >= -epsilon );
+        ts[i] = t;
+        px[i] = nx[i] = ox[i] + t * dx[i];
+        py[i] = ny[i] = oy[i] + t * dy[i];
+        pz[i] = nz[i] = oz[i] + t * dz[i];
+    }
+}
+
+float Sphere::distanceToBoundary( const QVector3D& point ) const
+{
+    return radius - point.length();
+}
+
 BoundingBox Sphere::boundingBox() const
 {
     return BoundingBox( QVector3D( -radius, -radius, -radius ),
@@ -0,0 +1,158 @@
+#include "HardwareCounters.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+    const char* counterNames[HardwareCounters::NbCounters] =
+    {
+        "cycles",
+        "instructions",
+        "llcMisses",
+        "branchMisses"
+    };
+
+#ifdef __linux__
+    const quint64 counterConfigs[HardwareCounters::NbCounters] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, // Last level cache
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // A counter of the calling thread, stopped until its group leader starts
+    int openCounter( quint64 config, int groupLeader )
+    {
+        perf_event_attr attributes;
+        memset( &attributes, 0, sizeof( attributes ) );
+        attributes.size = sizeof( attributes );
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = config;
+        attributes.read_format = PERF_FORMAT_GROUP;
+        attributes.disabled = ( groupLeader < 0 ) ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        return syscall( __NR_perf_event_open, &attributes, 0, -1, groupLeader, 0 );
+    }
+#endif
+}
+
+HardwareCounters::HardwareCounters()
+    : _isEnabled( false )
+    , _thread( 0 )
+{
+}
+
+HardwareCounters::~HardwareCounters()
+{
+    close();
+}
+
+bool HardwareCounters::enable()
+{
+#ifdef __linux__
+    if ( _isEnabled )
+        return true;
+
+#ifdef _OPENMP
+    int nbThreads = omp_get_max_threads();
+#else
+    int nbThreads = 1;
+#endif
+
+    _descriptors.fill( -1, nbThreads * NbCounters );
+    bool isOpened = true;
+
+    // The counters follow the thread that opens them
+#pragma omp parallel num_threads( nbThreads ) reduction( && : isOpened )
+    {
+#ifdef _OPENMP
+        int* descriptors = _descriptors.data() + omp_get_thread_num() * NbCounters;
+#else
+        int* descriptors = _descriptors.data();
+#endif
+
+        for ( int i=0 ; i<NbCounters && isOpened ; ++i )
+        {
+            descriptors[i] = openCounter( counterConfigs[i], ( i > 0 ) ? descriptors[0] : -1 );
+            isOpened = descriptors[i] >= 0;
+        }
+    }
+
+    if ( !isOpened )
+    {
+        close();
+        return false;
+    }
+
+    for ( int i=0 ; i<_descriptors.size() ; i+=NbCounters )
+        ioctl( _descriptors[i], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+
+    _thread = QThread::currentThread();
+    _isEnabled = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HardwareCounters::isEnabled() const
+{
+    return _isEnabled;
+}
+
+bool HardwareCounters::isCountingThread() const
+{
+    return _isEnabled && QThread::currentThread() == _thread;
+}
+
+void HardwareCounters::read( Counts& counts ) const
+{
+    for ( int i=0 ; i<NbCounters ; ++i )
+        counts.values[i] = 0;
+
+#ifdef __linux__
+    // The number of counters, then their values
+    quint64 group[1 + NbCounters];
+
+    for ( int i=0 ; i<_descriptors.size() ; i+=NbCounters )
+        if ( ::read( _descriptors[i], group, sizeof( group ) ) == sizeof( group ) )
+            for ( int j=0 ; j<NbCounters ; ++j )
+                counts.values[j] += group[1 + j];
+#endif
+}
+
+const char* HardwareCounters::counterName( Counter counter )
+{
+    return counterNames[counter];
+}
+
+HardwareCounters& HardwareCounters::counters()
+{
+    static HardwareCounters counters;
+    return counters;
+}
+
+void HardwareCounters::close()
+{
+#ifdef __linux__
+    for ( int i=0 ; i<_descriptors.size() ; ++i )
+        if ( _descriptors[i] >= 0 )
+            ::close( _descriptors[i] );
+#endif
+
+    _descriptors.clear();
+    _isEnabled = false;
+}
@@ -0,0 +1,60 @@
+#ifndef HARDWARECOUNTERS_H
+#define HARDWARECOUNTERS_H
+
+#include <QThread>
+#include <QVector>
+#include <QtGlobal>
+
+/* Hardware performance counters of the simulation, through the Linux
+ * perf_event_open system call: cycles, instructions, last level cache misses
+ * and branch misses, counted in user space for each OpenMP thread and summed.
+ * With the instructions per cycle and the cache misses, they tell whether a
+ * phase is bound by the computations or by the memory.
+ *
+ * They are off until 'enable' succeeds, which needs Linux, a processor whose
+ * counters are visible ( often not in virtual machines ) and a
+ * perf_event_paranoid of 2 or less. Only the OpenMP threads of the thread
+ * that enabled them are counted. Read from another thread, such as the
+ * surface thread ( see SurfaceThread ), they would count the simulation
+ * running meanwhile, so the scopes of other threads are not counted ( see
+ * 'isCountingThread' ).
+ */
+
+class HardwareCounters
+{
+public:
+    enum Counter { Cycles, Instructions, CacheMisses, BranchMisses, NbCounters };
+
+    struct Counts
+    {
+        quint64 values[NbCounters];
+    };
+
+    HardwareCounters();
+    ~HardwareCounters();
+
+    bool enable();
+    bool isEnabled() const;
+    bool isCountingThread() const;
+    void read( Counts& counts ) const;
+
+    static const char* counterName( Counter counter );
+    static HardwareCounters& counters();
+
+private:
+    HardwareCounters( const HardwareCounters& );
+    HardwareCounters& operator=( const HardwareCounters& );
+
+    void close();
+
+private:
+    // For each thread, the descriptor of each counter, the first one leading
+    // the group read at once
+    QVector<int> _descriptors;
+    bool _isEnabled;
+
+    // The thread whose OpenMP team is counted
+    QThread* _thread;
+};
+
+#endif // HARDWARECOUNTERS_H
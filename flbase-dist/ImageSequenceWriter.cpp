@@ -0,0 +1,234 @@
+#include "ImageSequenceWriter.h"
+#include <QtOpenGL>
+#include <QDataStream>
+#include <QFile>
+#include <QImage>
+#include <QRunnable>
+
+#if !defined(GL_BGRA)
+#define GL_BGRA 0x80E1
+#endif
+
+namespace
+{
+    // Frames between the read of the pixels and their encoding
+    static int nbPixelBuffers = 3;
+
+    // Frames waiting for an encoder before 'capture' blocks
+    static int maxPendingFrames = 16;
+
+    QString frameFileName( const QString& fileName, unsigned int frame )
+    {
+        return fileName.arg( frame, 5, 10, QChar( '0' ) );
+    }
+
+    void writeAttribute( QDataStream& stream, const char* name, const char* type, int size )
+    {
+        stream.writeRawData( name, strlen( name ) + 1 );
+        stream.writeRawData( type, strlen( type ) + 1 );
+        stream << qint32( size );
+    }
+
+    // Uncompressed scanline OpenEXR, with the RGBA channels as 32 bits floats.
+    // The rows are given bottom to top, as OpenGL reads them.
+    bool writeExr( const QString& fileName, const QVector<float>& pixels, int width, int height )
+    {
+        QFile file( fileName );
+
+        if ( !file.open( QIODevice::WriteOnly ) )
+            return false;
+
+        QDataStream stream( &file );
+        stream.setByteOrder( QDataStream::LittleEndian );
+        stream.setFloatingPointPrecision( QDataStream::SinglePrecision );
+
+        // Magic number and version 2, single part scanline
+        stream << qint32( 20000630 ) << qint32( 2 );
+
+        // The channels must be sorted by name
+        const char* channels[4] = { "A", "B", "G", "R" };
+        const int channelOffsets[4] = { 3, 2, 1, 0 };
+
+        writeAttribute( stream, "channels", "chlist", 4 * 18 + 1 );
+        for ( unsigned int i=0 ; i<4 ; ++i )
+        {
+            stream.writeRawData( channels[i], 2 );
+            stream << qint32( 2 ) << quint8( 0 ) << quint8( 0 ) << quint8( 0 ) << quint8( 0 ) << qint32( 1 ) << qint32( 1 );
+        }
+        stream << quint8( 0 );
+
+        writeAttribute( stream, "compression", "compression", 1 );
+        stream << quint8( 0 );
+        writeAttribute( stream, "dataWindow", "box2i", 16 );
+        stream << qint32( 0 ) << qint32( 0 ) << qint32( width - 1 ) << qint32( height - 1 );
+        writeAttribute( stream, "displayWindow", "box2i", 16 );
+        stream << qint32( 0 ) << qint32( 0 ) << qint32( width - 1 ) << qint32( height - 1 );
+        writeAttribute( stream, "lineOrder", "lineOrder", 1 );
+        stream << quint8( 0 );
+        writeAttribute( stream, "pixelAspectRatio", "float", 4 );
+        stream << 1.0f;
+        writeAttribute( stream, "screenWindowCenter", "v2f", 8 );
+        stream << 0.0f << 0.0f;
+        writeAttribute( stream, "screenWindowWidth", "float", 4 );
+        stream << 1.0f;
+        stream << quint8( 0 );
+
+        // Offsets of the scanlines, which follow the table
+        int lineSize = width * 4 * sizeof( float );
+        quint64 offset = file.pos() + height * sizeof( quint64 );
+
+        for ( int y=0 ; y<height ; ++y )
+            stream << quint64( offset + y * ( 2 * sizeof( qint32 ) + lineSize ) );
+
+        for ( int y=0 ; y<height ; ++y )
+        {
+            const float* row = pixels.constData() + ( height - 1 - y ) * width * 4;
+            stream << qint32( y ) << qint32( lineSize );
+
+            for ( unsigned int i=0 ; i<4 ; ++i )
+                for ( int x=0 ; x<width ; ++x )
+                    stream << row[ 4 * x + channelOffsets[i] ];
+        }
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    class EncodeTask : public QRunnable
+    {
+    public:
+        EncodeTask( const QString& fileName, int width, int height, QSemaphore& pendingFrames )
+            : _fileName( fileName )
+            , _width( width )
+            , _height( height )
+            , _pendingFrames( pendingFrames )
+        {
+        }
+
+        QImage image;
+        QVector<float> floatPixels;
+
+        virtual void run()
+        {
+            bool saved = floatPixels.isEmpty() ? image.mirrored().save( _fileName )
+                                               : writeExr( _fileName, floatPixels, _width, _height );
+
+            if ( !saved )
+                qWarning() << "Cannot write" << _fileName;
+
+            _pendingFrames.release();
+        }
+
+    private:
+        QString _fileName;
+        int _width;
+        int _height;
+        QSemaphore& _pendingFrames;
+    };
+}
+
+ImageSequenceWriter::ImageSequenceWriter( const QString& fileName, int width, int height )
+    : _fileName( fileName )
+    , _width( width )
+    , _height( height )
+    , _isFloatingPoint( fileName.endsWith( ".exr", Qt::CaseInsensitive ) )
+    , _nbFrames( 0 )
+    , _nbEncoded( 0 )
+    , _pendingFrames( maxPendingFrames )
+{
+    _encoders.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() / 2 ) );
+}
+
+ImageSequenceWriter::~ImageSequenceWriter()
+{
+    _encoders.waitForDone();
+}
+
+void ImageSequenceWriter::initialize()
+{
+    int frameSize = _width * _height * 4 * ( _isFloatingPoint ? sizeof( float ) : sizeof( unsigned char ) );
+
+    for ( int i=0 ; i<nbPixelBuffers ; ++i )
+    {
+        QGLBuffer buffer( QGLBuffer::PixelPackBuffer );
+        buffer.create();
+        buffer.bind();
+        buffer.setUsagePattern( QGLBuffer::StreamRead );
+        buffer.allocate( frameSize );
+        buffer.release();
+        _pixelBuffers.append( buffer );
+    }
+}
+
+void ImageSequenceWriter::capture()
+{
+    // The oldest buffer is reused, so its frame must be encoded first
+    if ( _nbFrames - _nbEncoded == (unsigned int)nbPixelBuffers )
+        encodeOldest();
+
+    QGLBuffer& buffer = _pixelBuffers[ _nbFrames % nbPixelBuffers ];
+    buffer.bind();
+    glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+
+    if ( _isFloatingPoint )
+        glReadPixels( 0, 0, _width, _height, GL_RGBA, GL_FLOAT, 0 );
+    else
+        glReadPixels( 0, 0, _width, _height, GL_BGRA, GL_UNSIGNED_BYTE, 0 );
+
+    buffer.release();
+    ++_nbFrames;
+}
+
+void ImageSequenceWriter::finish()
+{
+    while ( _nbEncoded < _nbFrames )
+        encodeOldest();
+
+    _encoders.waitForDone();
+}
+
+bool ImageSequenceWriter::isFloatingPoint() const
+{
+    return _isFloatingPoint;
+}
+
+unsigned int ImageSequenceWriter::nbFrames() const
+{
+    return _nbFrames;
+}
+
+void ImageSequenceWriter::encodeOldest()
+{
+    _pendingFrames.acquire();
+
+    EncodeTask* task = new EncodeTask( frameFileName( _fileName, _nbEncoded ), _width, _height, _pendingFrames );
+    QGLBuffer& buffer = _pixelBuffers[ _nbEncoded % nbPixelBuffers ];
+    buffer.bind();
+    const void* pixels = buffer.map( QGLBuffer::ReadOnly );
+
+    if ( !pixels )
+    {
+        qWarning() << "Cannot map the pixels of frame" << _nbEncoded;
+        buffer.release();
+        _pendingFrames.release();
+        delete task;
+        ++_nbEncoded;
+        return;
+    }
+
+    if ( _isFloatingPoint )
+    {
+        task->floatPixels.resize( _width * _height * 4 );
+        memcpy( task->floatPixels.data(), pixels, task->floatPixels.size() * sizeof( float ) );
+    }
+    else
+    {
+        task->image = QImage( _width, _height, QImage::Format_RGB32 );
+        memcpy( task->image.bits(), pixels, _width * _height * 4 );
+    }
+
+    buffer.unmap();
+    buffer.release();
+    ++_nbEncoded;
+
+    _encoders.start( task );
+}
@@ -0,0 +1,50 @@
+#ifndef IMAGESEQUENCEWRITER_H
+#define IMAGESEQUENCEWRITER_H
+
+#include <QGLBuffer>
+#include <QSemaphore>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+/* Saves the frames rendered in the current framebuffer as a sequence of
+ * images, without stalling the rendering. 'capture' only starts copying the
+ * pixels into a pixel buffer of a small ring, and maps the buffer filled a
+ * few frames earlier, when the copy is done. The pixels are then encoded by
+ * a pool of threads.
+ *
+ * The file name must contain '%1', replaced by the frame number. Names ending
+ * by '.exr' are saved as 32 bits floating point OpenEXR images, the others in
+ * any format QImage can write ( png, jpg, ... ).
+ */
+
+class ImageSequenceWriter
+{
+public:
+    ImageSequenceWriter( const QString& fileName, int width, int height );
+    ~ImageSequenceWriter();
+
+    void initialize();
+    void capture();
+    void finish();
+
+    bool isFloatingPoint() const;
+    unsigned int nbFrames() const;
+
+private:
+    void encodeOldest();
+
+private:
+    QString _fileName;
+    int _width;
+    int _height;
+    bool _isFloatingPoint;
+    unsigned int _nbFrames;   // Captured
+    unsigned int _nbEncoded;  // Sent to the encoders
+
+    QVector<QGLBuffer> _pixelBuffers;
+    QThreadPool _encoders;
+    QSemaphore _pendingFrames; // Bounds the memory held by the encoders
+};
+
+#endif // IMAGESEQUENCEWRITER_H
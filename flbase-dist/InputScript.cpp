@@ -0,0 +1,244 @@
+#include "InputScript.h"
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+
+namespace
+{
+    const char* actionNames[InputScript::NbActions] =
+    {
+        "renderMode",
+        "surfaceKernel",
+        "surfaceExtraction",
+        "surfaceThreading",
+        "material",
+        "viscositySolver",
+        "kernelFamily",
+        "kernelTabulation",
+        "loadBalancing",
+        "integrator",
+        "resetVelocities",
+        "pause"
+    };
+
+    void writeTransformation( QTextStream& stream, const char* name, const QMatrix4x4& transformation )
+    {
+        stream << name;
+
+        for ( int i=0 ; i<4 ; ++i )
+            for ( int j=0 ; j<4 ; ++j )
+                stream << ' ' << transformation( i, j );
+
+        stream << '\n';
+    }
+
+    bool readTransformation( const QStringList& words, QMatrix4x4& transformation )
+    {
+        if ( words.size() != 17 )
+            return false;
+
+        for ( int i=0 ; i<4 ; ++i )
+            for ( int j=0 ; j<4 ; ++j )
+                transformation( i, j ) = words[ 1 + 4 * i + j ].toFloat();
+
+        return true;
+    }
+}
+
+InputScript::InputScript()
+    : _nextFrame( 0 )
+{
+}
+
+void InputScript::setSceneName( const QString& sceneName )
+{
+    _sceneName = sceneName;
+}
+
+const QString& InputScript::sceneName() const
+{
+    return _sceneName;
+}
+
+void InputScript::recordAction( Action action )
+{
+    _pendingActions.append( action );
+}
+
+void InputScript::recordFrame( float deltaTime, Scene& scene )
+{
+    const QMatrix4x4& cameraTransformation = scene.activeCamera().localTransformation();
+    const QMatrix4x4& containerTransformation = scene.sph().localTransformation();
+
+    Frame frame;
+    frame.deltaTime = deltaTime;
+    frame.actions = _pendingActions;
+    frame.hasCameraTransformation = ( _frames.isEmpty() || cameraTransformation != _lastCameraTransformation );
+    frame.hasContainerTransformation = ( _frames.isEmpty() || containerTransformation != _lastContainerTransformation );
+    frame.cameraTransformation = cameraTransformation;
+    frame.containerTransformation = containerTransformation;
+    _frames.append( frame );
+
+    _pendingActions.clear();
+    _lastCameraTransformation = cameraTransformation;
+    _lastContainerTransformation = containerTransformation;
+}
+
+bool InputScript::save( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+        return false;
+
+    // Enough digits to read back the same floats
+    QTextStream stream( &file );
+    stream.setRealNumberPrecision( 9 );
+
+    if ( !_sceneName.isEmpty() )
+        stream << "scene " << _sceneName << '\n';
+
+    for ( int i=0 ; i<_frames.size() ; ++i )
+    {
+        const Frame& frame = _frames[i];
+        stream << "frame " << frame.deltaTime << '\n';
+
+        for ( int j=0 ; j<frame.actions.size() ; ++j )
+            stream << "action " << actionNames[ frame.actions[j] ] << '\n';
+
+        if ( frame.hasCameraTransformation )
+            writeTransformation( stream, "camera", frame.cameraTransformation );
+
+        if ( frame.hasContainerTransformation )
+            writeTransformation( stream, "container", frame.containerTransformation );
+    }
+
+    return stream.status() == QTextStream::Ok;
+}
+
+bool InputScript::load( const QString& fileName )
+{
+    QFile file( fileName );
+
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+        return false;
+
+    _sceneName.clear();
+    _frames.clear();
+    _nextFrame = 0;
+
+    QTextStream stream( &file );
+
+    while ( !stream.atEnd() )
+    {
+        QStringList words = stream.readLine().split( ' ', QString::SkipEmptyParts );
+
+        if ( words.isEmpty() )
+            continue;
+
+        // The name may have spaces, and comes before the frames
+        if ( words[0] == "scene" && words.size() >= 2 && _frames.isEmpty() )
+        {
+            _sceneName = QStringList( words.mid( 1 ) ).join( " " );
+            continue;
+        }
+
+        if ( words[0] == "frame" && words.size() == 2 )
+        {
+            _frames.append( Frame() );
+            _frames.last().deltaTime = words[1].toFloat();
+            continue;
+        }
+
+        if ( _frames.isEmpty() )
+            return false;
+
+        Frame& frame = _frames.last();
+
+        if ( words[0] == "action" && words.size() == 2 )
+        {
+            int action = 0;
+
+            while ( action < NbActions && words[1] != actionNames[action] )
+                ++action;
+
+            if ( action == NbActions )
+                return false;
+
+            frame.actions.append( Action( action ) );
+        }
+        else if ( words[0] == "camera" )
+        {
+            frame.hasCameraTransformation = readTransformation( words, frame.cameraTransformation );
+
+            if ( !frame.hasCameraTransformation )
+                return false;
+        }
+        else if ( words[0] == "container" )
+        {
+            frame.hasContainerTransformation = readTransformation( words, frame.containerTransformation );
+
+            if ( !frame.hasContainerTransformation )
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void InputScript::rewind()
+{
+    _nextFrame = 0;
+}
+
+bool InputScript::isFinished() const
+{
+    return _nextFrame >= _frames.size();
+}
+
+float InputScript::replayFrame( Scene& scene, bool& paused )
+{
+    const Frame& frame = _frames[ _nextFrame++ ];
+
+    for ( int i=0 ; i<frame.actions.size() ; ++i )
+        apply( frame.actions[i], scene, paused );
+
+    if ( frame.hasCameraTransformation )
+        scene.activeCamera().localTransformation() = frame.cameraTransformation;
+
+    if ( frame.hasContainerTransformation )
+        scene.sph().localTransformation() = frame.containerTransformation;
+
+    return frame.deltaTime;
+}
+
+unsigned int InputScript::nbFrames() const
+{
+    return _frames.size();
+}
+
+void InputScript::apply( Action action, Scene& scene, bool& paused )
+{
+    SPH& sph = scene.sph();
+
+    switch ( action )
+    {
+    case ChangeRenderMode : sph.changeRenderMode(); break;
+    case ChangeSurfaceKernel : sph.changeSurfaceKernel(); break;
+    case ChangeSurfaceExtraction : sph.changeSurfaceExtraction(); break;
+    case ChangeSurfaceThreading : sph.changeSurfaceThreading(); break;
+    case ChangeMaterial : sph.changeMaterial(); break;
+    case ChangeViscositySolver : sph.changeViscositySolver(); break;
+    case ChangeKernelFamily : sph.changeKernelFamily(); break;
+    case ChangeKernelTabulation : sph.changeKernelTabulation(); break;
+    case ChangeLoadBalancing : sph.changeLoadBalancing(); break;
+    case ChangeIntegrator : sph.changeIntegrator(); break;
+    case ResetVelocities : sph.resetVelocities(); break;
+    case Pause : paused = !paused; break;
+    default : break;
+    }
+}
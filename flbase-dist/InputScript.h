@@ -0,0 +1,90 @@
+#ifndef INPUTSCRIPT_H
+#define INPUTSCRIPT_H
+
+#include "Scenes/Scene.h"
+#include <QMatrix4x4>
+#include <QString>
+#include <QVector>
+
+/* A recording of what the user did to a scene, frame by frame: the time step,
+ * the actions of the keyboard, and the camera and container transformations
+ * given by the mouse. Replaying it, in the window or offscreen, runs the same
+ * simulation again, which makes the measures of two builds comparable.
+ *
+ * The file is text, one line per item, after the name of the scene, each
+ * frame starting by its time step:
+ *
+ *     scene Cube
+ *     frame 0.016
+ *     action pause
+ *     camera m11 m12 ... m44
+ *     container m11 m12 ... m44
+ *
+ * A transformation is only written when it changed. The replay must run on the
+ * scene of the recording, the scripts without one on any scene.
+ */
+
+class InputScript
+{
+public:
+    enum Action
+    {
+        ChangeRenderMode,
+        ChangeSurfaceKernel,
+        ChangeSurfaceExtraction,
+        ChangeSurfaceThreading,
+        ChangeMaterial,
+        ChangeViscositySolver,
+        ChangeKernelFamily,
+        ChangeKernelTabulation,
+        ChangeLoadBalancing,
+        ChangeIntegrator,
+        ResetVelocities,
+        Pause,
+        NbActions
+    };
+
+    InputScript();
+
+    void setSceneName( const QString& sceneName );
+    const QString& sceneName() const;
+
+    // Recording
+    void recordAction( Action action );
+    void recordFrame( float deltaTime, Scene& scene );
+    bool save( const QString& fileName ) const;
+
+    // Replay
+    bool load( const QString& fileName );
+    void rewind();
+    bool isFinished() const;
+    float replayFrame( Scene& scene, bool& paused );
+
+    unsigned int nbFrames() const;
+
+    static void apply( Action action, Scene& scene, bool& paused );
+
+private:
+    struct Frame
+    {
+        Frame() : deltaTime( 0 ), hasCameraTransformation( false ), hasContainerTransformation( false ) {}
+
+        float deltaTime;
+        QVector<Action> actions;
+        bool hasCameraTransformation;
+        bool hasContainerTransformation;
+        QMatrix4x4 cameraTransformation;
+        QMatrix4x4 containerTransformation;
+    };
+
+    QString _sceneName;
+    QVector<Frame> _frames;
+    int _nextFrame;
+
+    // Recording state
+    QVector<Action> _pendingActions;
+    QMatrix4x4 _lastCameraTransformation;
+    QMatrix4x4 _lastContainerTransformation;
+};
+
+#endif // INPUTSCRIPT_H
@@ -0,0 +1,196 @@
+#include "IntegratorComparison.h"
+#include "FrameArena.h"
+#include "Scenes/Scene.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    static unsigned int seed = 1;
+
+    // Steps with the time step of the scene before the measures, so that the
+    // random initial positions settle
+    static unsigned int nbSettlingSteps = 100;
+
+    // Time steps tried, from the one of the scene
+    static float deltaTimeGrowth = 1.25;
+    static unsigned int maxNbDeltaTimes = 16;
+}
+
+IntegratorComparison::IntegratorComparison( const QString& sceneName, unsigned int nbSteps )
+    : _sceneName( sceneName )
+    , _nbSteps( nbSteps )
+{
+}
+
+bool IntegratorComparison::run()
+{
+    _results.clear();
+
+    for ( int i=0 ; i<SPH::NbIntegrators ; ++i )
+    {
+        Result result;
+        result.integrator = SPH::Integrator( i );
+        result.maxStableDeltaTime = 0;
+        bool isStable = true;
+
+        // Until the first unstable time step
+        for ( unsigned int k=0 ; k<maxNbDeltaTimes && isStable ; ++k )
+        {
+            Result trial;
+
+            if ( !runIntegrator( SPH::Integrator( i ), std::pow( deltaTimeGrowth, float( k ) ), trial, isStable ) )
+                return false;
+
+            if ( isStable )
+                result = trial;
+        }
+
+        _results.append( result );
+    }
+
+    return true;
+}
+
+bool IntegratorComparison::runIntegrator( SPH::Integrator integrator, float deltaTimeScale, Result& result, bool& isStable )
+{
+    // The same initial particles for every run
+    srand( seed );
+    QVector<QPair<QString,Scene*> > scenes = Scene::createScenes();
+    Scene* scene = 0;
+
+    for ( int i=0 ; i<scenes.size() ; ++i )
+        if ( scenes[i].first.compare( _sceneName, Qt::CaseInsensitive ) == 0 )
+            scene = scenes[i].second;
+
+    if ( !scene )
+    {
+        for ( int i=0 ; i<scenes.size() ; ++i )
+            delete scenes[i].second;
+
+        return false;
+    }
+
+    SPH& sph = scene->sph();
+    sph.setIntegrator( integrator );
+
+    float deltaTime = sph.maxDeltaTime() * deltaTimeScale;
+    result.integrator = integrator;
+    result.maxStableDeltaTime = deltaTime;
+    result.meanDensityError = 0;
+    result.maxCfl = 0;
+    isStable = true;
+
+    TimeState timeState;
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+
+    // Clamped by SPH to the time step of the scene
+    for ( unsigned int step=0 ; step<nbSettlingSteps ; ++step )
+    {
+        FrameArena::newFrame();
+        timeState.newFrame( deltaTime );
+        sph.animate( timeState );
+    }
+
+    sph.setMaxDeltaTime( deltaTime );
+
+    for ( unsigned int step=0 ; step<_nbSteps && isStable ; ++step )
+    {
+        FrameArena::newFrame();
+        timeState.newFrame( deltaTime );
+
+        timer.start();
+        sph.animate( timeState );
+        elapsed += timer.nsecsElapsed();
+
+        const Particles& particles = sph.particles();
+        double densityError = 0;
+        double maxSpeed = 0;
+        bool isFinite = true;
+
+        for ( int i=0 ; i<particles.size() ; ++i )
+        {
+            // The pressure is the relative error of the uncorrected density
+            double speed = particles[i].velocity().length();
+
+            densityError += ::fabs( particles[i].pressure() );
+            maxSpeed = qMax( maxSpeed, speed );
+            isFinite = isFinite && ( speed == speed );
+        }
+
+        double cfl = maxSpeed * deltaTime / sph.smoothingRadius();
+        result.maxCfl = qMax( result.maxCfl, cfl );
+        result.meanDensityError += densityError / particles.size();
+        isStable = isFinite && cfl <= 1;
+    }
+
+    result.millisecondsPerStep = elapsed / 1e6 / qMax( _nbSteps, 1u );
+    result.meanDensityError /= qMax( _nbSteps, 1u );
+    result.simulatedTimePerSecond = ( elapsed > 0 ) ? _nbSteps * deltaTime / ( elapsed / 1e9 ) : 0;
+
+    for ( int i=0 ; i<scenes.size() ; ++i )
+        delete scenes[i].second;
+
+    return true;
+}
+
+QStringList IntegratorComparison::report() const
+{
+    QStringList lines;
+    lines.append( QString( "%1 steps at the largest stable time step" ).arg( _nbSteps ) );
+    lines.append( "integrator  max stable dt  ms/step  density err %   max CFL  simulated s/s" );
+
+    for ( int i=0 ; i<_results.size() ; ++i )
+    {
+        const Result& result = _results[i];
+
+        if ( result.maxStableDeltaTime == 0 )
+        {
+            lines.append( QString( "%1 unstable at the time step of the scene" ).arg( SPH::integratorName( result.integrator ), -11 ) );
+            continue;
+        }
+
+        lines.append( QString( "%1 %2 %3 %4 %5 %6" )
+                      .arg( SPH::integratorName( result.integrator ), -11 )
+                      .arg( result.maxStableDeltaTime, 14, 'f', 5 )
+                      .arg( result.millisecondsPerStep, 8, 'f', 2 )
+                      .arg( 100 * result.meanDensityError, 14, 'f', 3 )
+                      .arg( result.maxCfl, 9, 'f', 3 )
+                      .arg( result.simulatedTimePerSecond, 14, 'f', 3 ) );
+    }
+
+    return lines;
+}
+
+bool IntegratorComparison::writeSummary( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+        return false;
+
+    // One JSON object per integrator, errors as fractions of the rest density
+    QTextStream stream( &file );
+    stream << "{\n";
+
+    for ( int i=0 ; i<_results.size() ; ++i )
+    {
+        const Result& result = _results[i];
+
+        stream << "    \"" << SPH::integratorName( result.integrator ) << "\": { "
+               << "\"maxStableDt\": " << result.maxStableDeltaTime << ", "
+               << "\"msPerStep\": " << result.millisecondsPerStep << ", "
+               << "\"meanDensityError\": " << result.meanDensityError << ", "
+               << "\"maxCfl\": " << result.maxCfl << ", "
+               << "\"simulatedSecondsPerSecond\": " << result.simulatedTimePerSecond << " }"
+               << ( ( i + 1 < _results.size() ) ? ",\n" : "\n" );
+    }
+
+    stream << "}\n";
+
+    return stream.status() == QTextStream::Ok;
+}
@@ -0,0 +1,48 @@
+#ifndef INTEGRATORCOMPARISON_H
+#define INTEGRATORCOMPARISON_H
+
+#include "SPH/SPH.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/* Compares the integrators of SPH on a scene, without rendering, at the same
+ * stability. For each integrator, the scene runs from the same initial
+ * particles with larger and larger time steps, each a quarter larger than the
+ * last, starting from the one of the scene. A run is stable when no step moves
+ * a particle by more than the smoothing radius ( a CFL number above 1 ) or
+ * gives a NaN, as in KernelComparison. It reports, for the largest stable time
+ * step of each integrator, the computation time of a step, the density error
+ * and the simulated time per second of computation.
+ */
+
+class IntegratorComparison
+{
+public:
+    IntegratorComparison( const QString& sceneName, unsigned int nbSteps );
+
+    bool run();
+
+    QStringList report() const;
+    bool writeSummary( const QString& fileName ) const;
+
+private:
+    struct Result
+    {
+        SPH::Integrator integrator;
+        float maxStableDeltaTime;
+        double millisecondsPerStep;
+        double meanDensityError;
+        double maxCfl;
+        double simulatedTimePerSecond;
+    };
+
+    bool runIntegrator( SPH::Integrator integrator, float deltaTimeScale, Result& result, bool& isStable );
+
+private:
+    QString _sceneName;
+    unsigned int _nbSteps;
+    QVector<Result> _results;
+};
+
+#endif // INTEGRATORCOMPARISON_H
@@ -0,0 +1,197 @@
+#include "KernelComparison.h"
+#include "FrameArena.h"
+#include "Profiler.h"
+#include "Scenes/Scene.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    static unsigned int seed = 1;
+
+    // Steps with the time step of the scene before the measures, so that the
+    // random initial positions settle with every family
+    static unsigned int nbSettlingSteps = 100;
+}
+
+KernelComparison::KernelComparison( const QString& sceneName, unsigned int nbSteps, float deltaTime )
+    : _sceneName( sceneName )
+    , _nbSteps( nbSteps )
+    , _deltaTime( deltaTime )
+    , _isTabulated( false )
+{
+}
+
+void KernelComparison::setTabulated( bool isTabulated )
+{
+    _isTabulated = isTabulated;
+}
+
+bool KernelComparison::run()
+{
+    _results.clear();
+
+    for ( int i=0 ; i<SPH::NbKernelFamilies ; ++i )
+    {
+        Result result;
+
+        if ( !runFamily( SPH::KernelFamily( i ), result ) )
+            return false;
+
+        _results.append( result );
+    }
+
+    return true;
+}
+
+bool KernelComparison::runFamily( SPH::KernelFamily kernelFamily, Result& result )
+{
+    // The same initial particles for every family
+    srand( seed );
+    QVector<QPair<QString,Scene*> > scenes = Scene::createScenes();
+    Scene* scene = 0;
+
+    for ( int i=0 ; i<scenes.size() ; ++i )
+        if ( scenes[i].first.compare( _sceneName, Qt::CaseInsensitive ) == 0 )
+            scene = scenes[i].second;
+
+    if ( !scene )
+    {
+        for ( int i=0 ; i<scenes.size() ; ++i )
+            delete scenes[i].second;
+
+        return false;
+    }
+
+    SPH& sph = scene->sph();
+    sph.setKernelFamily( kernelFamily );
+    sph.setKernelTabulated( _isTabulated );
+
+    result.kernelFamily = kernelFamily;
+    result.meanDensityError = 0;
+    result.maxDensityError = 0;
+    result.maxCfl = 0;
+    result.nbStableSteps = 0;
+
+    TimeState timeState;
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+    quint64 nbPairs = 0;
+
+    // Clamped by SPH to the time step of the scene
+    for ( unsigned int step=0 ; step<nbSettlingSteps ; ++step )
+    {
+        FrameArena::newFrame();
+        timeState.newFrame( _deltaTime );
+        sph.animate( timeState );
+    }
+
+    Profiler::profiler().reset();
+    sph.setMaxDeltaTime( _deltaTime );
+
+    for ( unsigned int step=0 ; step<_nbSteps ; ++step )
+    {
+        FrameArena::newFrame();
+        timeState.newFrame( _deltaTime );
+
+        timer.start();
+        sph.animate( timeState );
+        elapsed += timer.nsecsElapsed();
+        nbPairs += sph.nbNeighborPairs();
+
+        const Particles& particles = sph.particles();
+        double densityError = 0;
+        double maxSpeed = 0;
+        bool isFinite = true;
+
+        for ( int i=0 ; i<particles.size() ; ++i )
+        {
+            // The pressure is the relative error of the uncorrected density
+            double error = ::fabs( particles[i].pressure() );
+            double speed = particles[i].velocity().length();
+
+            densityError += error;
+            result.maxDensityError = qMax( result.maxDensityError, error );
+            maxSpeed = qMax( maxSpeed, speed );
+            isFinite = isFinite && ( speed == speed );
+        }
+
+        double cfl = maxSpeed * _deltaTime / sph.smoothingRadius();
+        result.maxCfl = qMax( result.maxCfl, cfl );
+
+        if ( !isFinite || cfl > 1 )
+            break;
+
+        result.meanDensityError += densityError / particles.size();
+        ++result.nbStableSteps;
+    }
+
+    const LatencyHistogram& densities = Profiler::profiler().histogram( Profiler::Densities );
+    const LatencyHistogram& forces = Profiler::profiler().histogram( Profiler::Forces );
+    double pairsTime = double( densities.mean() ) * densities.count() + double( forces.mean() ) * forces.count();
+
+    result.nanosecondsPerPair = ( nbPairs > 0 ) ? pairsTime / nbPairs : 0;
+    result.meanDensityError /= qMax( result.nbStableSteps, 1u );
+    result.simulatedTimePerSecond = ( elapsed > 0 ) ? result.nbStableSteps * _deltaTime / ( elapsed / 1e9 ) : 0;
+
+    for ( int i=0 ; i<scenes.size() ; ++i )
+        delete scenes[i].second;
+
+    return true;
+}
+
+QStringList KernelComparison::report() const
+{
+    QStringList lines;
+    lines.append( QString( "%1 steps of %2 s%3" ).arg( _nbSteps ).arg( _deltaTime ).arg( _isTabulated ? ", tabulated" : "" ) );
+    lines.append( "kernel       ns/pair  density err %  max err %   max CFL  stable steps  simulated s/s" );
+
+    for ( int i=0 ; i<_results.size() ; ++i )
+    {
+        const Result& result = _results[i];
+
+        lines.append( QString( "%1 %2 %3 %4 %5 %6 %7" )
+                      .arg( SPH::kernelFamilyName( result.kernelFamily ), -11 )
+                      .arg( result.nanosecondsPerPair, 8, 'f', 2 )
+                      .arg( 100 * result.meanDensityError, 14, 'f', 3 )
+                      .arg( 100 * result.maxDensityError, 10, 'f', 3 )
+                      .arg( result.maxCfl, 9, 'f', 3 )
+                      .arg( result.nbStableSteps, 13 )
+                      .arg( result.simulatedTimePerSecond, 14, 'f', 3 ) );
+    }
+
+    return lines;
+}
+
+bool KernelComparison::writeSummary( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+        return false;
+
+    // One JSON object per kernel family, errors as fractions of the rest density
+    QTextStream stream( &file );
+    stream << "{\n";
+
+    for ( int i=0 ; i<_results.size() ; ++i )
+    {
+        const Result& result = _results[i];
+
+        stream << "    \"" << SPH::kernelFamilyName( result.kernelFamily ) << "\": { "
+               << "\"nsPerPair\": " << result.nanosecondsPerPair << ", "
+               << "\"meanDensityError\": " << result.meanDensityError << ", "
+               << "\"maxDensityError\": " << result.maxDensityError << ", "
+               << "\"maxCfl\": " << result.maxCfl << ", "
+               << "\"stableSteps\": " << result.nbStableSteps << ", "
+               << "\"simulatedSecondsPerSecond\": " << result.simulatedTimePerSecond << " }"
+               << ( ( i + 1 < _results.size() ) ? ",\n" : "\n" );
+    }
+
+    stream << "}\n";
+
+    return stream.status() == QTextStream::Ok;
+}
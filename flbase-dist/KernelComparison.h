@@ -0,0 +1,55 @@
+#ifndef KERNELCOMPARISON_H
+#define KERNELCOMPARISON_H
+
+#include "SPH/SPH.h"
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/* Compares the kernel families of SPH ( see SPH/Kernels.h ) on a scene, without
+ * rendering. Each family runs the scene from the same initial particles: a few
+ * steps with the time step of the scene let the random positions settle, then
+ * the measured steps use a fixed time step, which may be larger than the one
+ * the scene allows. It reports:
+ *
+ *  - the cost of the density and force loops per neighbor pair;
+ *  - how stable it stayed: the density error and the largest movement in a
+ *    step relative to the smoothing radius ( the CFL number ). A step moving a
+ *    particle by more than the smoothing radius, or giving a NaN, ends the run;
+ *  - the simulated time per second of computation, up to that step.
+ */
+
+class KernelComparison
+{
+public:
+    KernelComparison( const QString& sceneName, unsigned int nbSteps, float deltaTime );
+
+    void setTabulated( bool isTabulated );
+    bool run();
+
+    QStringList report() const;
+    bool writeSummary( const QString& fileName ) const;
+
+private:
+    struct Result
+    {
+        SPH::KernelFamily kernelFamily;
+        double nanosecondsPerPair;
+        double meanDensityError;
+        double maxDensityError;
+        double maxCfl;
+        unsigned int nbStableSteps;
+        double simulatedTimePerSecond;
+    };
+
+    bool runFamily( SPH::KernelFamily kernelFamily, Result& result );
+
+private:
+    QString _sceneName;
+    unsigned int _nbSteps;
+    float _deltaTime;
+    bool _isTabulated;
+    QVector<Result> _results;
+};
+
+#endif // KERNELCOMPARISON_H
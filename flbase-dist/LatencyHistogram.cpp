@@ -0,0 +1,105 @@
+#include "LatencyHistogram.h"
+
+namespace
+{
+    // Buckets per power of two is 'halfBucketCount', the first power of
+    // two holding all 'subBucketCount' values below it
+    static int subBucketBits = 6;
+    static int subBucketCount = 1 << subBucketBits;
+    static int halfBucketCount = subBucketCount / 2;
+
+    // Values are kept in units of 1024 ns, up to 2^32 of them ( about 73 min )
+    static int unitShift = 10;
+    static int maxBucket = 32 - subBucketBits;
+    static int nbBuckets = ( maxBucket + 2 ) * halfBucketCount;
+
+    int floorLog2( quint64 value )
+    {
+        int log = 0;
+
+        while ( value >>= 1 )
+            ++log;
+
+        return log;
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+    : _counts( nbBuckets, 0 )
+    , _count( 0 )
+    , _sum( 0 )
+    , _max( 0 )
+{
+}
+
+void LatencyHistogram::record( qint64 nanoseconds )
+{
+    if ( nanoseconds < 0 )
+        nanoseconds = 0;
+
+    ++_counts[ bucketIndex( nanoseconds >> unitShift ) ];
+    ++_count;
+    _sum += nanoseconds;
+    _max = qMax( _max, nanoseconds );
+}
+
+void LatencyHistogram::reset()
+{
+    _counts.fill( 0 );
+    _count = 0;
+    _sum = 0;
+    _max = 0;
+}
+
+quint64 LatencyHistogram::count() const
+{
+    return _count;
+}
+
+qint64 LatencyHistogram::percentile( double percent ) const
+{
+    if ( _count == 0 )
+        return 0;
+
+    quint64 rank = qMax( quint64( 1 ), quint64( percent / 100.0 * _count + 0.5 ) );
+    quint64 cumulated = 0;
+
+    for ( int i=0 ; i<_counts.size() ; ++i )
+    {
+        cumulated += _counts[i];
+
+        if ( cumulated >= rank )
+            return qMin( qint64( bucketUpperValue( i ) << unitShift ), _max );
+    }
+
+    return _max;
+}
+
+qint64 LatencyHistogram::mean() const
+{
+    return ( _count > 0 ) ? _sum / _count : 0;
+}
+
+qint64 LatencyHistogram::max() const
+{
+    return _max;
+}
+
+int LatencyHistogram::bucketIndex( quint64 value )
+{
+    // Linear below 'subBucketCount', then 'halfBucketCount' buckets per power of two
+    int bucket = qMax( 0, floorLog2( value | 1 ) - subBucketBits + 1 );
+
+    if ( bucket > maxBucket )
+        return nbBuckets - 1;
+
+    return bucket * halfBucketCount + int( value >> bucket );
+}
+
+quint64 LatencyHistogram::bucketUpperValue( int index )
+{
+    int bucket = qMax( 0, index / halfBucketCount - 1 );
+    quint64 subBucket = index - bucket * halfBucketCount;
+
+    return ( ( subBucket + 1 ) << bucket ) - 1;
+}
@@ -0,0 +1,38 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QVector>
+#include <QtGlobal>
+
+/* Histogram of durations with a bounded relative error, in the manner of
+ * HdrHistogram: each power of two is split in 32 linear buckets, so any
+ * percentile is known within about 3%, from a microsecond to an hour, with
+ * less than a thousand counters. Recording is a few shifts and an increment,
+ * cheap enough for every frame and every phase.
+ */
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record( qint64 nanoseconds );
+    void reset();
+
+    quint64 count() const;
+    qint64 percentile( double percent ) const; // In nanoseconds
+    qint64 mean() const;
+    qint64 max() const;
+
+private:
+    static int bucketIndex( quint64 microseconds );
+    static quint64 bucketUpperValue( int index );
+
+private:
+    QVector<quint32> _counts;
+    quint64 _count;
+    quint64 _sum;     // In nanoseconds
+    qint64 _max;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,138 @@
+#include "LiveMetrics.h"
+#include "MemoryFootprint.h"
+#include <QTextStream>
+
+namespace
+{
+    // Period over which the step rate is measured, in nanoseconds
+    static const qint64 stepRatePeriod = 1000000000;
+
+    void writeHeader( QTextStream& stream, const char* name, const char* type, const char* help )
+    {
+        stream << "# HELP " << name << " " << help << "\n"
+               << "# TYPE " << name << " " << type << "\n";
+    }
+}
+
+LiveMetrics::LiveMetrics()
+    : _isEnabled( false )
+    , _nbSteps( 0 )
+    , _simulatedTime( 0 )
+    , _stepRate( 0 )
+    , _nbParticles( 0 )
+    , _maxSpeed( 0 )
+    , _maxDensityError( 0 )
+    , _rateStartStep( 0 )
+{
+    for ( int i=0 ; i<Profiler::NbPhases ; ++i )
+    {
+        _nbPhaseCalls[i] = 0;
+        _phaseNanoseconds[i] = 0;
+        _lastPhaseNanoseconds[i] = 0;
+    }
+}
+
+void LiveMetrics::enable()
+{
+    _isEnabled = true;
+}
+
+bool LiveMetrics::isEnabled() const
+{
+    return _isEnabled.load( std::memory_order_relaxed );
+}
+
+void LiveMetrics::recordPhase( Profiler::Phase phase, qint64 nanoseconds )
+{
+    _nbPhaseCalls[phase].fetch_add( 1, std::memory_order_relaxed );
+    _phaseNanoseconds[phase].fetch_add( nanoseconds, std::memory_order_relaxed );
+    _lastPhaseNanoseconds[phase].store( nanoseconds, std::memory_order_relaxed );
+}
+
+void LiveMetrics::recordStep( unsigned int nbParticles, float deltaTime, float maxSpeed, float maxDensityError )
+{
+    // Only the simulation thread writes these, a load and a store are enough
+    quint64 nbSteps = _nbSteps.load( std::memory_order_relaxed ) + 1;
+    _nbSteps.store( nbSteps, std::memory_order_relaxed );
+    _simulatedTime.store( _simulatedTime.load( std::memory_order_relaxed ) + deltaTime, std::memory_order_relaxed );
+    _nbParticles.store( nbParticles, std::memory_order_relaxed );
+    _maxSpeed.store( maxSpeed, std::memory_order_relaxed );
+    _maxDensityError.store( maxDensityError, std::memory_order_relaxed );
+
+    if ( !_rateTimer.isValid() )
+    {
+        _rateTimer.start();
+        _rateStartStep = nbSteps;
+    }
+    else if ( _rateTimer.nsecsElapsed() >= stepRatePeriod )
+    {
+        _stepRate.store( ( nbSteps - _rateStartStep ) * 1e9 / _rateTimer.nsecsElapsed(), std::memory_order_relaxed );
+        _rateTimer.restart();
+        _rateStartStep = nbSteps;
+    }
+}
+
+QByteArray LiveMetrics::exposition() const
+{
+    QByteArray text;
+    QTextStream stream( &text );
+    stream.setRealNumberPrecision( 9 );
+
+    writeHeader( stream, "flbase_steps_total", "counter", "Simulation steps done." );
+    stream << "flbase_steps_total " << _nbSteps.load( std::memory_order_relaxed ) << "\n";
+
+    writeHeader( stream, "flbase_step_rate", "gauge", "Simulation steps per second, over about the last second." );
+    stream << "flbase_step_rate " << _stepRate.load( std::memory_order_relaxed ) << "\n";
+
+    writeHeader( stream, "flbase_simulated_seconds_total", "counter", "Simulated time, in seconds." );
+    stream << "flbase_simulated_seconds_total " << _simulatedTime.load( std::memory_order_relaxed ) << "\n";
+
+    writeHeader( stream, "flbase_particles", "gauge", "Number of particles simulated." );
+    stream << "flbase_particles " << _nbParticles.load( std::memory_order_relaxed ) << "\n";
+
+    writeHeader( stream, "flbase_max_speed", "gauge", "Largest particle speed of the last step." );
+    stream << "flbase_max_speed " << _maxSpeed.load( std::memory_order_relaxed ) << "\n";
+
+    writeHeader( stream, "flbase_max_density_error", "gauge", "Largest relative density error of the last step." );
+    stream << "flbase_max_density_error " << _maxDensityError.load( std::memory_order_relaxed ) << "\n";
+
+    // Phases, with the average over any interval given by the two counters
+    writeHeader( stream, "flbase_phase_calls_total", "counter", "Number of times each phase ran." );
+
+    for ( int i=0 ; i<Profiler::NbPhases ; ++i )
+        stream << "flbase_phase_calls_total{phase=\"" << Profiler::phaseName( Profiler::Phase( i ) ) << "\"} "
+               << _nbPhaseCalls[i].load( std::memory_order_relaxed ) << "\n";
+
+    writeHeader( stream, "flbase_phase_seconds_total", "counter", "Time spent in each phase, in seconds." );
+
+    for ( int i=0 ; i<Profiler::NbPhases ; ++i )
+        stream << "flbase_phase_seconds_total{phase=\"" << Profiler::phaseName( Profiler::Phase( i ) ) << "\"} "
+               << _phaseNanoseconds[i].load( std::memory_order_relaxed ) / 1e9 << "\n";
+
+    writeHeader( stream, "flbase_phase_last_seconds", "gauge", "Duration of the last run of each phase, in seconds." );
+
+    for ( int i=0 ; i<Profiler::NbPhases ; ++i )
+        stream << "flbase_phase_last_seconds{phase=\"" << Profiler::phaseName( Profiler::Phase( i ) ) << "\"} "
+               << _lastPhaseNanoseconds[i].load( std::memory_order_relaxed ) / 1e9 << "\n";
+
+    // Memory footprint, itself kept in atomics
+    const MemoryFootprint& footprint = MemoryFootprint::memoryFootprint();
+    writeHeader( stream, "flbase_memory_bytes", "gauge", "Bytes held by each subsystem." );
+
+    for ( int i=0 ; i<MemoryFootprint::NbSubsystems ; ++i )
+        stream << "flbase_memory_bytes{subsystem=\"" << MemoryFootprint::subsystemName( MemoryFootprint::Subsystem( i ) ) << "\"} "
+               << quint64( footprint.current( MemoryFootprint::Subsystem( i ) ) ) << "\n";
+
+    writeHeader( stream, "flbase_memory_peak_bytes", "gauge", "Most bytes held by all the subsystems at once." );
+    stream << "flbase_memory_peak_bytes " << quint64( footprint.peakTotal() ) << "\n";
+
+    stream.flush();
+
+    return text;
+}
+
+LiveMetrics& LiveMetrics::liveMetrics()
+{
+    static LiveMetrics liveMetrics;
+    return liveMetrics;
+}
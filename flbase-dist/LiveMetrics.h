@@ -0,0 +1,63 @@
+#ifndef LIVEMETRICS_H
+#define LIVEMETRICS_H
+
+#include "Profiler.h"
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <atomic>
+
+/* What a running simulation shows to the outside ( see MetricsServer ): the
+ * steps done and their rate, the simulated time, the number of calls and the
+ * time of each phase, the number of particles, the largest speed and density
+ * error of the last step, and the memory footprint ( see MemoryFootprint ).
+ *
+ * Each value is written by the thread that owns it in relaxed atomics, so
+ * recording never waits for a reader and 'exposition' may run on any thread.
+ * The values of a single exposition are therefore not all from the same step.
+ *
+ * Nothing is recorded before 'enable', so the simulation does not measure the
+ * speeds and densities when nobody reads them.
+ */
+
+class LiveMetrics
+{
+public:
+    LiveMetrics();
+
+    void enable();
+    bool isEnabled() const;
+
+    void recordPhase( Profiler::Phase phase, qint64 nanoseconds );
+    void recordStep( unsigned int nbParticles, float deltaTime, float maxSpeed, float maxDensityError );
+
+    // In the text format of Prometheus
+    QByteArray exposition() const;
+
+    static LiveMetrics& liveMetrics();
+
+private:
+    LiveMetrics( const LiveMetrics& );
+    LiveMetrics& operator=( const LiveMetrics& );
+
+private:
+    std::atomic<bool> _isEnabled;
+
+    // Written by the simulation thread
+    std::atomic<quint64> _nbSteps;
+    std::atomic<double> _simulatedTime;
+    std::atomic<float> _stepRate;
+    std::atomic<unsigned int> _nbParticles;
+    std::atomic<float> _maxSpeed;
+    std::atomic<float> _maxDensityError;
+
+    // Written by the thread recording each phase
+    std::atomic<quint64> _nbPhaseCalls[Profiler::NbPhases];
+    std::atomic<quint64> _phaseNanoseconds[Profiler::NbPhases];
+    std::atomic<qint64> _lastPhaseNanoseconds[Profiler::NbPhases];
+
+    // Steps counted since the step rate was last updated, about every second
+    QElapsedTimer _rateTimer;
+    quint64 _rateStartStep;
+};
+
+#endif // LIVEMETRICS_H
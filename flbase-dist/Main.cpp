@@ -1,22 +1,245 @@
 #include <QApplication>
+#include <QDebug>
+#include <QStringList>
+#include "BatchRunner.h"
+#include "GLWidget.h"
+#include "HardwareCounters.h"
+#include "IntegratorComparison.h"
+#include "KernelComparison.h"
+#include "LiveMetrics.h"
 #include "MainWindow.h"
+#include "MetricsServer.h"
+#include "Profiler.h"
+
+namespace
+{
+    QString argumentValue( const QStringList& arguments, const QString& name, const QString& defaultValue )
+    {
+        int index = arguments.indexOf( name );
+
+        if ( index < 0 || index + 1 >= arguments.size() )
+            return defaultValue;
+
+        return arguments[ index + 1 ];
+    }
+
+    void writeSummary( const QStringList& arguments )
+    {
+        QString summary = argumentValue( arguments, "--summary", "" );
+
+        if ( !summary.isEmpty() && !Profiler::profiler().writeSummary( summary ) )
+            qCritical() << "Cannot write" << summary;
+    }
+
+    bool loadScript( const QStringList& arguments, InputScript& script )
+    {
+        QString fileName = argumentValue( arguments, "--replay", "" );
+
+        if ( !fileName.isEmpty() && !script.load( fileName ) )
+        {
+            qCritical() << "Cannot read the input script" << fileName;
+            return false;
+        }
+
+        return true;
+    }
+
+    // The scene of a replay is the one of its script, which --scene may only
+    // confirm, and otherwise the one of --scene
+    bool sceneName( const QStringList& arguments, const InputScript& script, const QString& defaultName, QString& name )
+    {
+        name = argumentValue( arguments, "--scene", "" );
+
+        if ( !script.sceneName().isEmpty() )
+        {
+            if ( !name.isEmpty() && name.compare( script.sceneName(), Qt::CaseInsensitive ) != 0 )
+            {
+                qCritical() << "The input script was recorded on the scene" << script.sceneName() << "not" << name;
+                return false;
+            }
+
+            name = script.sceneName();
+        }
+
+        if ( name.isEmpty() )
+            name = defaultName;
+
+        return true;
+    }
+
+    // flbase --offscreen [--scene Cube] [--frames 300] [--size 1280x720] [--dt 0.01]
+    //        [--mode particles|surface|screenspace] [--output frames/cube_%1.png]
+    //        [--summary summary.json] [--replay input.txt]
+    int runOffscreen( const QStringList& arguments )
+    {
+        InputScript script;
+        QString name;
+
+        if ( !loadScript( arguments, script ) || !sceneName( arguments, script, "Sphere", name ) )
+            return 1;
+
+        QStringList size = argumentValue( arguments, "--size", "1280x720" ).split( 'x' );
+        QString mode = argumentValue( arguments, "--mode", "particles" );
+        QVector<QPair<QString,Scene*> > scenes = Scene::createScenes();
+        Scene* scene = 0;
+
+        for ( int i=0 ; i<scenes.size() ; ++i )
+            if ( scenes[i].first.compare( name, Qt::CaseInsensitive ) == 0 )
+                scene = scenes[i].second;
+
+        if ( !scene || size.size() != 2 )
+        {
+            qCritical() << "Unknown scene or size";
+            return 1;
+        }
+
+        if ( mode == "surface" )
+            scene->sph().setRenderMode( SPH::RenderImplicitSurface );
+        else if ( mode == "screenspace" )
+            scene->sph().setRenderMode( SPH::RenderScreenSpace );
+
+        BatchRunner runner( *scene,
+                            size[0].toInt(), size[1].toInt(),
+                            argumentValue( arguments, "--frames", "300" ).toUInt(),
+                            argumentValue( arguments, "--dt", "0.01" ).toFloat() );
+        runner.setOutput( argumentValue( arguments, "--output", "" ) );
+
+        if ( arguments.contains( "--replay" ) )
+            runner.setInputScript( &script );
+
+        bool succeeded = runner.run();
+        writeSummary( arguments );
+
+        for ( int i=0 ; i<scenes.size() ; ++i )
+            delete scenes[i].second;
+
+        return succeeded ? 0 : 1;
+    }
+
+    // flbase --compare-kernels [--scene Sphere] [--steps 500] [--dt 0.01] [--tabulated]
+    //        [--summary kernels.json]
+    int runKernelComparison( const QStringList& arguments )
+    {
+        KernelComparison comparison( argumentValue( arguments, "--scene", "Sphere" ),
+                                     argumentValue( arguments, "--steps", "500" ).toUInt(),
+                                     argumentValue( arguments, "--dt", "0.01" ).toFloat() );
+        comparison.setTabulated( arguments.contains( "--tabulated" ) );
+
+        if ( !comparison.run() )
+        {
+            qCritical() << "Unknown scene";
+            return 1;
+        }
+
+        QStringList report = comparison.report();
+
+        for ( int i=0 ; i<report.size() ; ++i )
+            qDebug() << qPrintable( report[i] );
+
+        QString summary = argumentValue( arguments, "--summary", "" );
+
+        if ( !summary.isEmpty() && !comparison.writeSummary( summary ) )
+        {
+            qCritical() << "Cannot write" << summary;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    // flbase --compare-integrators [--scene Sphere] [--steps 300] [--summary integrators.json]
+    int runIntegratorComparison( const QStringList& arguments )
+    {
+        IntegratorComparison comparison( argumentValue( arguments, "--scene", "Sphere" ),
+                                         argumentValue( arguments, "--steps", "300" ).toUInt() );
+
+        if ( !comparison.run() )
+        {
+            qCritical() << "Unknown scene";
+            return 1;
+        }
+
+        QStringList report = comparison.report();
+
+        for ( int i=0 ; i<report.size() ; ++i )
+            qDebug() << qPrintable( report[i] );
+
+        QString summary = argumentValue( arguments, "--summary", "" );
+
+        if ( !summary.isEmpty() && !comparison.writeSummary( summary ) )
+        {
+            qCritical() << "Cannot write" << summary;
+            return 1;
+        }
+
+        return 0;
+    }
+}
 
 int main(int argc, char *argv[])
 {
 
     QApplication application( argc, argv );
 
+    // flbase ... --counters, in every mode
+    if ( application.arguments().contains( "--counters" ) && !HardwareCounters::counters().enable() )
+        qWarning() << "The hardware counters are not available";
+
+    // flbase ... --metrics-port 9464, in every mode, on the loopback interface
+    MetricsServer metricsServer;
+    quint16 metricsPort = argumentValue( application.arguments(), "--metrics-port", "0" ).toUShort();
+
+    if ( metricsPort != 0 )
+    {
+        if ( metricsServer.listen( metricsPort ) )
+        {
+            LiveMetrics::liveMetrics().enable();
+            metricsServer.start();
+        }
+        else
+        {
+            qWarning() << "Cannot serve the metrics on port" << metricsPort;
+        }
+    }
+
+    if ( application.arguments().contains( "--offscreen" ) )
+        return runOffscreen( application.arguments() );
+
+    if ( application.arguments().contains( "--compare-kernels" ) )
+        return runKernelComparison( application.arguments() );
+
+    if ( application.arguments().contains( "--compare-integrators" ) )
+        return runIntegratorComparison( application.arguments() );
+
+    // flbase [--scene Cube] [--summary summary.json] [--record input.txt | --replay input.txt]
+    QStringList arguments = application.arguments();
+    QString recording = argumentValue( arguments, "--record", "" );
+    InputScript script;
+    QString name;
+
+    if ( !loadScript( arguments, script ) || !sceneName( arguments, script, "", name ) )
+        return 1;
+
+    // The frames are paced by the FrameScheduler of the GLWidget
     MainWindow mainWindow;
     mainWindow.show();
 
-    // Realtime loop (maybe not the best possible way to be implemented in Qt)
-    while( !mainWindow.isHidden() )
+    if ( !name.isEmpty() && !mainWindow.selectScene( name ) )
     {
-        if ( application.hasPendingEvents() )
-            application.processEvents();
-
-        mainWindow.onIdle();
+        qCritical() << "Unknown scene" << name;
+        return 1;
     }
 
-    return 0;
+    if ( !recording.isEmpty() )
+        mainWindow.glWidget()->startRecording( mainWindow.sceneName() );
+    else if ( arguments.contains( "--replay" ) )
+        mainWindow.glWidget()->startReplay( script );
+
+    int result = application.exec();
+    writeSummary( arguments );
+
+    if ( !recording.isEmpty() && !mainWindow.glWidget()->recording().save( recording ) )
+        qCritical() << "Cannot write the input script" << recording;
+
+    return result;
 }
@@ -1,14 +1,11 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
-#include "Scenes/SceneCube.h"
-#include "Scenes/SceneCylinder.h"
-#include "Scenes/SceneSphere.h"
-#include "Scenes/SceneSphereHighRes.h"
 #include <QDesktopWidget>
 
 MainWindow::MainWindow( QWidget* parent )
     : QMainWindow( parent )
     , ui( new Ui::MainWindow )
+    , _sceneItem( 0 )
 {
     ui->setupUi(this);
     buildSceneList();
@@ -27,18 +24,36 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-void MainWindow::onIdle()
+GLWidget* MainWindow::glWidget()
 {
-    ui->glWidget->onIdle();
+    return ui->glWidget;
+}
+
+bool MainWindow::selectScene( const QString& sceneName )
+{
+    for ( int i=0 ; i<ui->sceneList->count() ; ++i )
+    {
+        QListWidgetItem* item = ui->sceneList->item( i );
+
+        if ( item->text().compare( sceneName, Qt::CaseInsensitive ) == 0 )
+        {
+            ui->sceneList->setCurrentItem( item );
+            onSceneListItemClicked( item );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+QString MainWindow::sceneName() const
+{
+    return _sceneItem ? _sceneItem->text() : QString();
 }
 
 void MainWindow::buildSceneList()
 {
-    QVector<QPair<QString,Scene*> > scenes;
-    scenes.append( QPair<QString,Scene*>( "Sphere", new SceneSphere ) );
-    scenes.append( QPair<QString,Scene*>( "Cube", new SceneCube ) );
-    scenes.append( QPair<QString,Scene*>( "Cylinder", new SceneCylinder ) );
-    scenes.append( QPair<QString,Scene*>( "Sphere - High resolution", new SceneSphereHighRes ) );
+    QVector<QPair<QString,Scene*> > scenes = Scene::createScenes();
 
     for ( int i=0 ; i<scenes.size() ; ++i )
     {
@@ -53,5 +68,13 @@ void MainWindow::buildSceneList()
 
 void MainWindow::onSceneListItemClicked( QListWidgetItem* item )
 {
+    // The recorded or replayed script is the one of the current scene
+    if ( _sceneItem && ui->glWidget->isScripted() )
+    {
+        ui->sceneList->setCurrentItem( _sceneItem );
+        return;
+    }
+
+    _sceneItem = item;
     ui->glWidget->setScene( (Scene*)item->data( Qt::UserRole ).value<void*>() );
 }
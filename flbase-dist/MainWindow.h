@@ -12,6 +12,7 @@ namespace Ui
     class MainWindow;
 }
 
+class GLWidget;
 class QListWidgetItem;
 
 class MainWindow : public QMainWindow
@@ -22,7 +23,11 @@ public:
     explicit MainWindow( QWidget* parent = 0 );
     ~MainWindow();
 
-    void onIdle();
+    GLWidget* glWidget();
+
+    // By the name of the scene list, without regard to case
+    bool selectScene( const QString& sceneName );
+    QString sceneName() const;
 
 private slots:
     void onSceneListItemClicked( QListWidgetItem* item );
@@ -32,6 +37,7 @@ private:
 
 private:
     Ui::MainWindow* ui;
+    QListWidgetItem* _sceneItem;
 };
 
 #endif // MAINWINDOW_H
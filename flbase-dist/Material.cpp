@@ -33,3 +33,15 @@ float Material::refractiveIndex() const
 {
     return _refractiveIndex;
 }
+
+bool Material::operator==( const Material& other ) const
+{
+    return _isUsingCubemap == other._isUsingCubemap &&
+           _diffuse == other._diffuse &&
+           _refractiveIndex == other._refractiveIndex;
+}
+
+bool Material::operator!=( const Material& other ) const
+{
+    return !( *this == other );
+}
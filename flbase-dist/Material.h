@@ -17,6 +17,9 @@ public:
     const QColor& diffuse() const;
     float refractiveIndex() const;
 
+    bool operator==( const Material& other ) const;
+    bool operator!=( const Material& other ) const;
+
 private:
     bool _isUsingCubemap;
     QColor _diffuse;
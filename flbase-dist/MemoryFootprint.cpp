@@ -0,0 +1,146 @@
+#include "MemoryFootprint.h"
+
+namespace
+{
+    const char* subsystemNames[MemoryFootprint::NbSubsystems] =
+    {
+        "particles",
+        "neighborhoods",
+        "cells",
+        "tiles",
+        "snapshot",
+        "kernels",
+        "lattice",
+        "adaptive",
+        "mesh",
+        "glBuffers",
+        "arenas"
+    };
+
+    double megabytes( size_t bytes )
+    {
+        return bytes / ( 1024.0 * 1024.0 );
+    }
+
+    void raisePeak( std::atomic<size_t>& peak, size_t bytes )
+    {
+        size_t previous = peak.load( std::memory_order_relaxed );
+
+        while ( previous < bytes && !peak.compare_exchange_weak( previous, bytes, std::memory_order_relaxed ) )
+            ;
+    }
+}
+
+MemoryFootprint::MemoryFootprint()
+    : _total( 0 )
+    , _peakTotal( 0 )
+    , _nbParticles( 0 )
+{
+    for ( int i=0 ; i<NbSubsystems ; ++i )
+    {
+        _current[i] = 0;
+        _peaks[i] = 0;
+    }
+}
+
+void MemoryFootprint::record( Subsystem subsystem, size_t bytes )
+{
+    size_t previous = _current[subsystem].exchange( bytes, std::memory_order_relaxed );
+
+    // The difference wraps around when the subsystem shrinks, which the
+    // unsigned addition undoes
+    size_t total = _total.fetch_add( bytes - previous, std::memory_order_relaxed ) + bytes - previous;
+
+    raisePeak( _peaks[subsystem], bytes );
+    raisePeak( _peakTotal, total );
+}
+
+void MemoryFootprint::setNbParticles( unsigned int nbParticles )
+{
+    _nbParticles.store( nbParticles, std::memory_order_relaxed );
+}
+
+void MemoryFootprint::reset()
+{
+    for ( int i=0 ; i<NbSubsystems ; ++i )
+    {
+        _current[i] = 0;
+        _peaks[i] = 0;
+    }
+
+    _total = 0;
+    _peakTotal = 0;
+}
+
+size_t MemoryFootprint::current( Subsystem subsystem ) const
+{
+    return _current[subsystem].load( std::memory_order_relaxed );
+}
+
+size_t MemoryFootprint::peak( Subsystem subsystem ) const
+{
+    return _peaks[subsystem].load( std::memory_order_relaxed );
+}
+
+size_t MemoryFootprint::total() const
+{
+    return _total.load( std::memory_order_relaxed );
+}
+
+size_t MemoryFootprint::peakTotal() const
+{
+    return _peakTotal.load( std::memory_order_relaxed );
+}
+
+unsigned int MemoryFootprint::nbParticles() const
+{
+    return _nbParticles.load( std::memory_order_relaxed );
+}
+
+QStringList MemoryFootprint::report() const
+{
+    QStringList lines;
+
+    if ( peakTotal() == 0 )
+        return lines;
+
+    // In megabytes, and in bytes per particle of the simulation
+    double particleCount = qMax( nbParticles(), 1u );
+
+    lines.append( QString( "%1 %2 %3 %4" )
+                  .arg( "memory (MB)", -13 )
+                  .arg( "current", 7 )
+                  .arg( "peak", 7 )
+                  .arg( "bytes/p", 13 ) );
+
+    for ( int i=0 ; i<NbSubsystems ; ++i )
+    {
+        if ( peak( Subsystem( i ) ) == 0 )
+            continue;
+
+        lines.append( QString( "%1 %2 %3 %4" )
+                      .arg( subsystemNames[i], -13 )
+                      .arg( megabytes( current( Subsystem( i ) ) ), 7, 'f', 2 )
+                      .arg( megabytes( peak( Subsystem( i ) ) ), 7, 'f', 2 )
+                      .arg( current( Subsystem( i ) ) / particleCount, 13, 'f', 0 ) );
+    }
+
+    lines.append( QString( "%1 %2 %3 %4" )
+                  .arg( "total", -13 )
+                  .arg( megabytes( total() ), 7, 'f', 2 )
+                  .arg( megabytes( peakTotal() ), 7, 'f', 2 )
+                  .arg( total() / particleCount, 13, 'f', 0 ) );
+
+    return lines;
+}
+
+const char* MemoryFootprint::subsystemName( Subsystem subsystem )
+{
+    return subsystemNames[subsystem];
+}
+
+MemoryFootprint& MemoryFootprint::memoryFootprint()
+{
+    static MemoryFootprint memoryFootprint;
+    return memoryFootprint;
+}
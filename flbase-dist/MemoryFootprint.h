@@ -0,0 +1,56 @@
+#ifndef MEMORYFOOTPRINT_H
+#define MEMORYFOOTPRINT_H
+
+#include <QStringList>
+#include <atomic>
+#include <cstddef>
+
+/* Bytes held by each subsystem of the simulation and of the rendering, with
+ * the peak of each one and of their total, to know how many particles fit in
+ * a given memory. The owners count the capacity of their arrays, not only the
+ * part in use, and each subsystem is recorded again whenever it may have
+ * grown.
+ *
+ * An owner must be measured by the thread that modifies it, the surface by
+ * the thread that extracts it ( see SurfaceThread ). Recording is lock free,
+ * so the footprint may be recorded and read from any thread.
+ *
+ * The GL buffers are the vertex data sent to the graphics card, the textures
+ * and framebuffers of the screen space renderer are not counted.
+ */
+
+class MemoryFootprint
+{
+public:
+    enum Subsystem { Particles, GridNeighborhoods, GridCells, Tiles, SurfaceSnapshot, SurfaceKernels, SurfaceLattice,
+                     AdaptiveLattice, SurfaceMesh, GLBuffers, FrameArenas, NbSubsystems };
+
+    MemoryFootprint();
+
+    void record( Subsystem subsystem, size_t bytes );
+    void setNbParticles( unsigned int nbParticles );
+    void reset();
+
+    size_t current( Subsystem subsystem ) const;
+    size_t peak( Subsystem subsystem ) const;
+    size_t total() const;
+    size_t peakTotal() const;
+    unsigned int nbParticles() const;
+    QStringList report() const;
+
+    static const char* subsystemName( Subsystem subsystem );
+    static MemoryFootprint& memoryFootprint();
+
+private:
+    MemoryFootprint( const MemoryFootprint& );
+    MemoryFootprint& operator=( const MemoryFootprint& );
+
+private:
+    std::atomic<size_t> _current[NbSubsystems];
+    std::atomic<size_t> _peaks[NbSubsystems];
+    std::atomic<size_t> _total;
+    std::atomic<size_t> _peakTotal;
+    std::atomic<unsigned int> _nbParticles;
+};
+
+#endif // MEMORYFOOTPRINT_H
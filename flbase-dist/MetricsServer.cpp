@@ -0,0 +1,183 @@
+#include "MetricsServer.h"
+#include "LiveMetrics.h"
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_UNIX) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace
+{
+    // How long the thread waits before checking whether it must stop, and
+    // how long a client may take to send its request, in milliseconds
+    static const int stopCheckInterval = 200;
+    static const int requestTimeout = 1000;
+
+    // Longest request read, the rest of the headers being ignored
+    static const int maxRequestSize = 4096;
+
+#ifdef Q_OS_UNIX
+    bool sendAll( int connection, const QByteArray& data )
+    {
+        const char* current = data.constData();
+        int left = data.size();
+
+        while ( left > 0 )
+        {
+            ssize_t sent = ::send( connection, current, left, MSG_NOSIGNAL );
+
+            if ( sent <= 0 )
+                return false;
+
+            current += sent;
+            left -= sent;
+        }
+
+        return true;
+    }
+#endif
+}
+
+MetricsServer::MetricsServer()
+    : _socket( -1 )
+    , _isStopping( false )
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+bool MetricsServer::listen( quint16 port )
+{
+#ifdef Q_OS_UNIX
+    if ( _socket >= 0 )
+        return false;
+
+    _socket = ::socket( AF_INET, SOCK_STREAM, 0 );
+
+    if ( _socket < 0 )
+        return false;
+
+    int reuse = 1;
+    ::setsockopt( _socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof( reuse ) );
+
+    sockaddr_in address;
+    memset( &address, 0, sizeof( address ) );
+    address.sin_family = AF_INET;
+    address.sin_port = htons( port );
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+
+    if ( ::bind( _socket, reinterpret_cast<sockaddr*>( &address ), sizeof( address ) ) != 0 ||
+         ::listen( _socket, 8 ) != 0 )
+    {
+        ::close( _socket );
+        _socket = -1;
+        return false;
+    }
+
+    return true;
+#else
+    Q_UNUSED( port );
+    return false;
+#endif
+}
+
+void MetricsServer::stop()
+{
+    _isStopping = true;
+    wait();
+
+#ifdef Q_OS_UNIX
+    if ( _socket >= 0 )
+        ::close( _socket );
+#endif
+
+    _socket = -1;
+}
+
+void MetricsServer::run()
+{
+#ifdef Q_OS_UNIX
+    pollfd listening;
+    listening.fd = _socket;
+    listening.events = POLLIN;
+
+    while ( !_isStopping )
+    {
+        if ( ::poll( &listening, 1, stopCheckInterval ) <= 0 )
+            continue;
+
+        int connection = ::accept( _socket, 0, 0 );
+
+        if ( connection < 0 )
+            continue;
+
+        answer( connection );
+        ::close( connection );
+    }
+#endif
+}
+
+void MetricsServer::answer( int connection )
+{
+#ifdef Q_OS_UNIX
+    // Read until the end of the headers, only the request line is used
+    QByteArray request;
+    pollfd client;
+    client.fd = connection;
+    client.events = POLLIN;
+
+    while ( !request.contains( "\r\n\r\n" ) && request.size() < maxRequestSize )
+    {
+        char buffer[1024];
+
+        if ( ::poll( &client, 1, requestTimeout ) <= 0 )
+            return;
+
+        ssize_t received = ::recv( connection, buffer, sizeof( buffer ), 0 );
+
+        if ( received <= 0 )
+            return;
+
+        request.append( buffer, received );
+    }
+
+    QList<QByteArray> requestLine = request.left( request.indexOf( "\r\n" ) ).split( ' ' );
+    QByteArray body;
+    QByteArray status;
+
+    if ( requestLine.size() < 2 || requestLine[0] != "GET" )
+    {
+        status = "405 Method Not Allowed";
+    }
+    else if ( requestLine[1] == "/metrics" || requestLine[1] == "/" )
+    {
+        status = "200 OK";
+        body = LiveMetrics::liveMetrics().exposition();
+    }
+    else
+    {
+        status = "404 Not Found";
+    }
+
+    QByteArray response = "HTTP/1.0 " + status + "\r\n"
+                          "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                          "Content-Length: " + QByteArray::number( body.size() ) + "\r\n"
+                          "Connection: close\r\n"
+                          "\r\n" + body;
+
+    sendAll( connection, response );
+#else
+    Q_UNUSED( connection );
+#endif
+}
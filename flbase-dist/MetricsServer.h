@@ -0,0 +1,36 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QThread>
+#include <atomic>
+
+/* Serves the live metrics ( see LiveMetrics ) over HTTP on the loopback
+ * interface, in the text format of Prometheus, so a monitoring system can
+ * scrape a long run while it goes on: GET /metrics.
+ *
+ * The requests are answered one at a time on the server's own thread, which
+ * only reads atomics and never holds up the simulation. The socket is only
+ * reachable from the machine itself. Without POSIX sockets, 'listen' fails.
+ */
+
+class MetricsServer : public QThread
+{
+public:
+    MetricsServer();
+    virtual ~MetricsServer();
+
+    bool listen( quint16 port );
+    void stop();
+
+protected:
+    virtual void run();
+
+private:
+    void answer( int connection );
+
+private:
+    int _socket;
+    std::atomic<bool> _isStopping;
+};
+
+#endif // METRICSSERVER_H
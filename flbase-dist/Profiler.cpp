@@ -0,0 +1,355 @@
+#include "Profiler.h"
+#include "LiveMetrics.h"
+#include "MemoryFootprint.h"
+#include <QFile>
+#include <QTextStream>
+
+namespace
+{
+    const char* phaseNames[Profiler::NbPhases] =
+    {
+        "frame",
+        "densities",
+        "forces",
+        "viscosity",
+        "move",
+        "surface",
+        "render"
+    };
+
+    // Frames sizing the arenas and buffers, which may allocate, after a reset
+    static unsigned int warmUpFrames = 30;
+
+    double milliseconds( qint64 nanoseconds )
+    {
+        return nanoseconds / 1e6;
+    }
+}
+
+Profiler::Profiler()
+    : _thread( QThread::currentThread() )
+    , _queueBegin( 0 )
+    , _queueEnd( 0 )
+    , _nbParticles( 0 )
+    , _lastFrameAllocations( 0 )
+    , _nbAllocationFrames( 0 )
+    , _nbAllocatingFrames( 0 )
+{
+    reset();
+}
+
+void Profiler::record( Phase phase, qint64 nanoseconds )
+{
+    if ( LiveMetrics::liveMetrics().isEnabled() )
+        LiveMetrics::liveMetrics().recordPhase( phase, nanoseconds );
+
+    if ( QThread::currentThread() != _thread )
+    {
+        queueSample( phase, nanoseconds );
+        return;
+    }
+
+    recordQueuedSamples();
+    _histograms[phase].record( nanoseconds );
+}
+
+void Profiler::recordThreadTimes( Phase phase, const QVector<qint64>& busyNanoseconds )
+{
+    QVector<qint64>& idleTimes = _threadIdleTimes[phase];
+    qint64 span = 0;
+
+    for ( int i=0 ; i<busyNanoseconds.size() ; ++i )
+        span = qMax( span, busyNanoseconds[i] );
+
+    if ( idleTimes.size() != busyNanoseconds.size() )
+        idleTimes.fill( 0, busyNanoseconds.size() );
+
+    for ( int i=0 ; i<busyNanoseconds.size() ; ++i )
+        idleTimes[i] += span - busyNanoseconds[i];
+
+    _threadSpans[phase] += span;
+}
+
+void Profiler::recordCounters( Phase phase, const HardwareCounters::Counts& counts )
+{
+    for ( int i=0 ; i<HardwareCounters::NbCounters ; ++i )
+        _counters[phase][i] += counts.values[i];
+
+    ++_nbCountedCalls[phase];
+    _nbCountedParticles[phase] += _nbParticles;
+}
+
+void Profiler::setNbParticles( unsigned int nbParticles )
+{
+    _nbParticles = nbParticles;
+}
+
+void Profiler::recordFrameAllocations( unsigned int nbAllocations )
+{
+    _lastFrameAllocations = nbAllocations;
+
+    if ( ++_nbAllocationFrames > warmUpFrames && nbAllocations > 0 )
+        ++_nbAllocatingFrames;
+}
+
+void Profiler::reset()
+{
+    // The durations queued before are dropped with the others
+    recordQueuedSamples();
+
+    for ( int i=0 ; i<NbPhases ; ++i )
+    {
+        _histograms[i].reset();
+
+        for ( int j=0 ; j<HardwareCounters::NbCounters ; ++j )
+            _counters[i][j] = 0;
+
+        _nbCountedCalls[i] = 0;
+        _nbCountedParticles[i] = 0;
+    }
+
+    _lastFrameAllocations = 0;
+    _nbAllocationFrames = 0;
+    _nbAllocatingFrames = 0;
+
+    resetThreadTimes();
+}
+
+void Profiler::resetThreadTimes()
+{
+    for ( int i=0 ; i<NbPhases ; ++i )
+    {
+        _threadIdleTimes[i].clear();
+        _threadSpans[i] = 0;
+    }
+}
+
+const LatencyHistogram& Profiler::histogram( Phase phase ) const
+{
+    return _histograms[phase];
+}
+
+QVector<double> Profiler::threadIdleFractions( Phase phase ) const
+{
+    QVector<double> fractions;
+
+    if ( _threadSpans[phase] > 0 )
+        for ( int i=0 ; i<_threadIdleTimes[phase].size() ; ++i )
+            fractions.append( double( _threadIdleTimes[phase][i] ) / _threadSpans[phase] );
+
+    return fractions;
+}
+
+QStringList Profiler::report() const
+{
+    QStringList lines;
+    lines.append( "phase       p50     p95     p99     max (ms)" );
+
+    for ( int i=0 ; i<NbPhases ; ++i )
+    {
+        const LatencyHistogram& histogram = _histograms[i];
+
+        if ( histogram.count() == 0 )
+            continue;
+
+        lines.append( QString( "%1 %2 %3 %4 %5" )
+                      .arg( phaseNames[i], -9 )
+                      .arg( milliseconds( histogram.percentile( 50 ) ), 7, 'f', 2 )
+                      .arg( milliseconds( histogram.percentile( 95 ) ), 7, 'f', 2 )
+                      .arg( milliseconds( histogram.percentile( 99 ) ), 7, 'f', 2 )
+                      .arg( milliseconds( histogram.max() ), 7, 'f', 2 ) );
+    }
+
+    // Idle time of each thread, in percents of the time of the slowest
+    for ( int i=0 ; i<NbPhases ; ++i )
+    {
+        QVector<double> fractions = threadIdleFractions( Phase( i ) );
+
+        if ( fractions.isEmpty() )
+            continue;
+
+        QString line = QString( "%1 idle" ).arg( phaseNames[i], -9 );
+
+        for ( int j=0 ; j<fractions.size() ; ++j )
+            line += QString( " %1" ).arg( fractions[j] * 100, 3, 'f', 0 );
+
+        lines.append( line + " (%)" );
+    }
+
+    if ( _nbAllocationFrames > 0 )
+        lines.append( QString( "heap allocations %1, frames allocating after warm up %2" )
+                      .arg( _lastFrameAllocations )
+                      .arg( _nbAllocatingFrames ) );
+
+    // Hardware counters, per call and per particle
+    bool hasCounters = false;
+
+    for ( int i=0 ; i<NbPhases ; ++i )
+    {
+        if ( _nbCountedCalls[i] == 0 )
+            continue;
+
+        if ( !hasCounters )
+            lines.append( "phase     Mcycles   IPC  cycles/p  LLC miss/p  br miss/p" );
+
+        hasCounters = true;
+        const quint64* counters = _counters[i];
+        double nbParticles = qMax( _nbCountedParticles[i], quint64( 1 ) );
+
+        lines.append( QString( "%1 %2 %3 %4 %5 %6" )
+                      .arg( phaseNames[i], -9 )
+                      .arg( counters[HardwareCounters::Cycles] / 1e6 / _nbCountedCalls[i], 7, 'f', 2 )
+                      .arg( double( counters[HardwareCounters::Instructions] ) / qMax( counters[HardwareCounters::Cycles], quint64( 1 ) ), 5, 'f', 2 )
+                      .arg( counters[HardwareCounters::Cycles] / nbParticles, 9, 'f', 0 )
+                      .arg( counters[HardwareCounters::CacheMisses] / nbParticles, 11, 'f', 2 )
+                      .arg( counters[HardwareCounters::BranchMisses] / nbParticles, 10, 'f', 2 ) );
+    }
+
+    return lines;
+}
+
+bool Profiler::writeSummary( const QString& fileName ) const
+{
+    QFile file( fileName );
+
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Text ) )
+        return false;
+
+    // One JSON object per phase, durations in milliseconds
+    QTextStream stream( &file );
+    stream << "{\n";
+
+    for ( int i=0 ; i<NbPhases ; ++i )
+    {
+        const LatencyHistogram& histogram = _histograms[i];
+
+        stream << "    \"" << phaseNames[i] << "\": { "
+               << "\"count\": " << histogram.count() << ", "
+               << "\"mean\": " << milliseconds( histogram.mean() ) << ", "
+               << "\"p50\": " << milliseconds( histogram.percentile( 50 ) ) << ", "
+               << "\"p95\": " << milliseconds( histogram.percentile( 95 ) ) << ", "
+               << "\"p99\": " << milliseconds( histogram.percentile( 99 ) ) << ", "
+               << "\"max\": " << milliseconds( histogram.max() ) << ", "
+               << "\"threadIdle\": [";
+
+        // Fraction of the time of the slowest thread each thread waited
+        QVector<double> fractions = threadIdleFractions( Phase( i ) );
+
+        for ( int j=0 ; j<fractions.size() ; ++j )
+            stream << ( ( j > 0 ) ? ", " : "" ) << fractions[j];
+
+        stream << "]";
+
+        // Hardware counters, per call and per particle
+        if ( _nbCountedCalls[i] > 0 )
+        {
+            double nbParticles = qMax( _nbCountedParticles[i], quint64( 1 ) );
+            stream << ", \"counters\": { ";
+
+            for ( int j=0 ; j<HardwareCounters::NbCounters ; ++j )
+            {
+                const char* name = HardwareCounters::counterName( HardwareCounters::Counter( j ) );
+
+                stream << ( ( j > 0 ) ? ", " : "" )
+                       << "\"" << name << "\": " << double( _counters[i][j] ) / _nbCountedCalls[i] << ", "
+                       << "\"" << name << "PerParticle\": " << _counters[i][j] / nbParticles;
+            }
+
+            stream << " }";
+        }
+
+        stream << " },\n";
+    }
+
+    // Frames that allocated from the heap after the warm up
+    stream << "    \"heapAllocations\": { "
+           << "\"frames\": " << _nbAllocationFrames << ", "
+           << "\"allocatingFrames\": " << _nbAllocatingFrames << " },\n";
+
+    // Current and peak bytes of each subsystem
+    const MemoryFootprint& footprint = MemoryFootprint::memoryFootprint();
+    stream << "    \"memory\": { ";
+
+    for ( int i=0 ; i<MemoryFootprint::NbSubsystems ; ++i )
+    {
+        MemoryFootprint::Subsystem subsystem = MemoryFootprint::Subsystem( i );
+
+        stream << "\"" << MemoryFootprint::subsystemName( subsystem ) << "\": { "
+               << "\"current\": " << quint64( footprint.current( subsystem ) ) << ", "
+               << "\"peak\": " << quint64( footprint.peak( subsystem ) ) << " }, ";
+    }
+
+    stream << "\"total\": { "
+           << "\"current\": " << quint64( footprint.total() ) << ", "
+           << "\"peak\": " << quint64( footprint.peakTotal() ) << " }, "
+           << "\"particles\": " << footprint.nbParticles() << " }\n"
+           << "}\n";
+
+    return stream.status() == QTextStream::Ok;
+}
+
+void Profiler::queueSample( Phase phase, qint64 nanoseconds )
+{
+    unsigned int end = _queueEnd.load( std::memory_order_relaxed );
+
+    // When the profiler's thread has not recorded for a long time, the
+    // newest durations are dropped
+    if ( end - _queueBegin.load( std::memory_order_acquire ) >= NbQueuedSamples )
+        return;
+
+    QueuedSample& sample = _queuedSamples[end % NbQueuedSamples];
+    sample.phase = phase;
+    sample.nanoseconds = nanoseconds;
+    _queueEnd.store( end + 1, std::memory_order_release );
+}
+
+void Profiler::recordQueuedSamples()
+{
+    unsigned int begin = _queueBegin.load( std::memory_order_relaxed );
+    unsigned int end = _queueEnd.load( std::memory_order_acquire );
+
+    for ( unsigned int i=begin ; i!=end ; ++i )
+    {
+        const QueuedSample& sample = _queuedSamples[i % NbQueuedSamples];
+        _histograms[sample.phase].record( sample.nanoseconds );
+    }
+
+    _queueBegin.store( end, std::memory_order_release );
+}
+
+const char* Profiler::phaseName( Phase phase )
+{
+    return phaseNames[phase];
+}
+
+Profiler& Profiler::profiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+ProfilerScope::ProfilerScope( Profiler::Phase phase )
+    : _phase( phase )
+    , _isCounting( HardwareCounters::counters().isCountingThread() )
+{
+    if ( _isCounting )
+        HardwareCounters::counters().read( _startCounts );
+
+    _timer.start();
+}
+
+ProfilerScope::~ProfilerScope()
+{
+    Profiler::profiler().record( _phase, _timer.nsecsElapsed() );
+
+    if ( _isCounting )
+    {
+        HardwareCounters::Counts counts;
+        HardwareCounters::counters().read( counts );
+
+        for ( int i=0 ; i<HardwareCounters::NbCounters ; ++i )
+            counts.values[i] -= _startCounts.values[i];
+
+        Profiler::profiler().recordCounters( _phase, counts );
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "HardwareCounters.h"
+#include "LatencyHistogram.h"
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <atomic>
+
+/* Durations of the frames and of the phases of the simulation and rendering,
+ * kept in histograms to follow the tail ( p95, p99, max ) and not only the
+ * average, which hides the stutters. The profiler belongs to the thread that
+ * first uses it, the only one touching the histograms. The durations recorded
+ * by another thread, the surface thread, are queued without lock and added by
+ * the profiler's thread when it next records, so the reports never read a
+ * histogram being written.
+ *
+ * ProfilerScope records the time spent until the end of its scope.
+ *
+ * For the parallel phases, the time each thread was busy is also kept to know
+ * how long the threads waited for the slowest one.
+ *
+ * When the hardware counters are enabled ( see HardwareCounters ), each scope
+ * also adds what they counted to its phase, reported per call and per particle
+ * of the simulation. The scopes of the surface thread are not counted, the
+ * counters following the threads of the simulation.
+ *
+ * Each frame also gives the number of blocks its arenas took from the heap
+ * ( see FrameArena ). Past the first frames, which size the arenas, a frame
+ * should take none; the frames that did are counted and reported.
+ *
+ * The summary also holds the memory footprint ( see MemoryFootprint ). The
+ * durations are also given to the live metrics when they are enabled ( see
+ * LiveMetrics ), the histograms being only safe to read from the thread
+ * recording them.
+ */
+
+class Profiler
+{
+public:
+    enum Phase { Frame, Densities, Forces, Viscosity, Move, Surface, Render, NbPhases };
+
+    Profiler();
+
+    void record( Phase phase, qint64 nanoseconds );
+    void recordThreadTimes( Phase phase, const QVector<qint64>& busyNanoseconds );
+    void recordCounters( Phase phase, const HardwareCounters::Counts& counts );
+    void setNbParticles( unsigned int nbParticles );
+    void recordFrameAllocations( unsigned int nbAllocations );
+    void reset();
+    void resetThreadTimes();
+
+    const LatencyHistogram& histogram( Phase phase ) const;
+    QVector<double> threadIdleFractions( Phase phase ) const;
+    QStringList report() const;
+    bool writeSummary( const QString& fileName ) const;
+
+    static const char* phaseName( Phase phase );
+    static Profiler& profiler();
+
+private:
+    void queueSample( Phase phase, qint64 nanoseconds );
+    void recordQueuedSamples();
+
+private:
+    LatencyHistogram _histograms[NbPhases];
+    QThread* _thread;
+
+    // Durations recorded by another thread, waiting for the profiler's. Only
+    // one other thread may record at a time, the queue has a single writer.
+    struct QueuedSample
+    {
+        Phase phase;
+        qint64 nanoseconds;
+    };
+
+    enum { NbQueuedSamples = 256 };
+    QueuedSample _queuedSamples[NbQueuedSamples];
+    std::atomic<unsigned int> _queueBegin;
+    std::atomic<unsigned int> _queueEnd;
+
+    // Per thread, the sum of the time waiting for the slowest thread, and
+    // the sum of the time of the slowest thread
+    QVector<qint64> _threadIdleTimes[NbPhases];
+    qint64 _threadSpans[NbPhases];
+
+    // Sums of the hardware counters, of the number of calls counted and of
+    // the number of particles at each of them
+    quint64 _counters[NbPhases][HardwareCounters::NbCounters];
+    quint64 _nbCountedCalls[NbPhases];
+    quint64 _nbCountedParticles[NbPhases];
+    unsigned int _nbParticles;
+
+    // Heap allocations of the last frame ( see FrameArena::frameHeapAllocations ),
+    // frames recorded, and frames past the warm up that allocated
+    unsigned int _lastFrameAllocations;
+    unsigned int _nbAllocationFrames;
+    unsigned int _nbAllocatingFrames;
+};
+
+class ProfilerScope
+{
+public:
+    ProfilerScope( Profiler::Phase phase );
+    ~ProfilerScope();
+
+private:
+    Profiler::Phase _phase;
+    QElapsedTimer _timer;
+    bool _isCounting;
+    HardwareCounters::Counts _startCounts;
+};
+
+#endif // PROFILER_H
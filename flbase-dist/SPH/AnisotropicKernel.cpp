@@ -0,0 +1,162 @@
+#include "AnisotropicKernel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Maximum ratio between the largest and the smallest axis of a kernel
+    static float maxStretch = 4;
+
+    // Maximum distance between the particle and the kernel center, relative
+    // to the smoothing radius
+    static float maxShift = 0.25;
+
+    // Eigen decomposition of a symmetric 3x3 matrix by Jacobi rotations.
+    // The eigenvectors are the columns of 'vectors'.
+    void eigenDecomposition( const float covariance[6], float values[3], float vectors[3][3] )
+    {
+        float a[3][3] = { { covariance[0], covariance[3], covariance[4] },
+                          { covariance[3], covariance[1], covariance[5] },
+                          { covariance[4], covariance[5], covariance[2] } };
+
+        for ( unsigned int i=0 ; i<3 ; ++i )
+            for ( unsigned int j=0 ; j<3 ; ++j )
+                vectors[i][j] = ( i == j ) ? 1 : 0;
+
+        for ( unsigned int sweep=0 ; sweep<16 ; ++sweep )
+        {
+            float offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+            float diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+
+            if ( offDiagonal <= 1e-12 * diagonal )
+                break;
+
+            for ( unsigned int p=0 ; p<2 ; ++p )
+            {
+                for ( unsigned int q=p+1 ; q<3 ; ++q )
+                {
+                    if ( a[p][q] == 0 )
+                        continue;
+
+                    float theta = ( a[q][q] - a[p][p] ) / ( 2 * a[p][q] );
+                    float t = ( ( theta >= 0 ) ? 1 : -1 ) / ( ::fabs( theta ) + ::sqrt( theta * theta + 1 ) );
+                    float c = 1 / ::sqrt( t * t + 1 );
+                    float s = t * c;
+
+                    for ( unsigned int k=0 ; k<3 ; ++k )
+                    {
+                        float akp = a[k][p];
+                        float akq = a[k][q];
+                        a[k][p] = c * akp - s * akq;
+                        a[k][q] = s * akp + c * akq;
+                    }
+
+                    for ( unsigned int k=0 ; k<3 ; ++k )
+                    {
+                        float apk = a[p][k];
+                        float aqk = a[q][k];
+                        a[p][k] = c * apk - s * aqk;
+                        a[q][k] = s * apk + c * aqk;
+                    }
+
+                    for ( unsigned int k=0 ; k<3 ; ++k )
+                    {
+                        float vkp = vectors[k][p];
+                        float vkq = vectors[k][q];
+                        vectors[k][p] = c * vkp - s * vkq;
+                        vectors[k][q] = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+
+        values[0] = a[0][0];
+        values[1] = a[1][1];
+        values[2] = a[2][2];
+    }
+}
+
+AnisotropicKernel::AnisotropicKernel()
+{
+    setIsotropic( QVector3D() );
+}
+
+void AnisotropicKernel::setIsotropic( const QVector3D& position )
+{
+    _center = position;
+    _transformation[0] = _transformation[1] = _transformation[2] = 1;
+    _transformation[3] = _transformation[4] = _transformation[5] = 0;
+    _determinant = 1;
+}
+
+void AnisotropicKernel::set( const QVector3D& position, const QVector3D& center, const float covariance[6], float smoothingRadius )
+{
+    float values[3];
+    float vectors[3][3];
+    eigenDecomposition( covariance, values, vectors );
+
+    float largest = std::max( values[0], std::max( values[1], values[2] ) );
+
+    if ( largest <= 0 )
+    {
+        setIsotropic( position );
+        return;
+    }
+
+    // Axis lengths relative to the largest one, clamped to avoid needle kernels
+    float axes[3];
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        axes[i] = std::max( values[i], largest / maxStretch ) / largest;
+
+    // Shrink the whole kernel so its support stays within the smoothing
+    // radius of the particle once moved to the smoothed center
+    QVector3D shift = center - position;
+    float shiftLength = shift.length() / smoothingRadius;
+
+    if ( shiftLength > maxShift )
+    {
+        shift *= maxShift / shiftLength;
+        shiftLength = maxShift;
+    }
+
+    float reach = 1 / ( 1 - shiftLength );
+
+    // G = R * diag( reach / axes ) * R^T
+    float scales[3] = { reach / axes[0], reach / axes[1], reach / axes[2] };
+    const unsigned int rows[6] = { 0, 1, 2, 0, 0, 1 };
+    const unsigned int columns[6] = { 0, 1, 2, 1, 2, 2 };
+
+    for ( unsigned int i=0 ; i<6 ; ++i )
+    {
+        _transformation[i] = 0;
+
+        for ( unsigned int k=0 ; k<3 ; ++k )
+            _transformation[i] += vectors[rows[i]][k] * scales[k] * vectors[columns[i]][k];
+    }
+
+    _center = position + shift;
+    _determinant = scales[0] * scales[1] * scales[2];
+}
+
+const QVector3D& AnisotropicKernel::center() const
+{
+    return _center;
+}
+
+float AnisotropicKernel::determinant() const
+{
+    return _determinant;
+}
+
+const float* AnisotropicKernel::transformation() const
+{
+    return _transformation;
+}
+
+QVector3D AnisotropicKernel::transform( const QVector3D& vector ) const
+{
+    return QVector3D( _transformation[0] * vector.x() + _transformation[3] * vector.y() + _transformation[4] * vector.z(),
+                      _transformation[3] * vector.x() + _transformation[1] * vector.y() + _transformation[5] * vector.z(),
+                      _transformation[4] * vector.x() + _transformation[5] * vector.y() + _transformation[2] * vector.z() );
+}
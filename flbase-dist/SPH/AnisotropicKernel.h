@@ -0,0 +1,39 @@
+#ifndef ANISOTROPICKERNEL_H
+#define ANISOTROPICKERNEL_H
+
+#include <QVector3D>
+
+/* The kernel of a particle used by the surface reconstruction. Its shape
+ * follows the principal axes of the neighbor distribution: a particle lying
+ * on a flat sheet of fluid gets a flat kernel, which gives smooth surfaces
+ * where an isotropic kernel gives blobs.
+ *
+ * The kernel is the linear transformation G applied to the distance to its
+ * center before evaluating the isotropic kernel, scaled by det(G) to keep
+ * the same mass. The support never extends past the smoothing radius around
+ * the particle, so the grid neighborhoods are still valid.
+ *
+ * See J. Yu et G. Turk. 2010
+ *     Reconstructing surfaces of particle-based fluids using anisotropic kernels.
+ */
+
+class AnisotropicKernel
+{
+public:
+    AnisotropicKernel();
+
+    void setIsotropic( const QVector3D& position );
+    void set( const QVector3D& position, const QVector3D& center, const float covariance[6], float smoothingRadius );
+
+    const QVector3D& center() const;
+    float determinant() const;
+    const float* transformation() const;
+    QVector3D transform( const QVector3D& vector ) const;
+
+private:
+    QVector3D _center;
+    float _transformation[6]; // Symmetric : xx, yy, zz, xy, xz, yz
+    float _determinant;
+};
+
+#endif // ANISOTROPICKERNEL_H
@@ -1,4 +1,5 @@
 #include "Grid.h"
+#include <algorithm>
 #include <cmath>
 
 Grid::Grid( const BoundingBox& boundingBox, unsigned int nbCellX, unsigned int nbCellY, unsigned int nbCellZ, float radius )
@@ -63,6 +64,25 @@ float Grid::shortestDistance( unsigned int x, unsigned int y, unsigned int z, un
     return difference.length();
 }
 
+void Grid::copyCells( const Grid& grid )
+{
+    // Element by element, so the lists of the two grids are never shared and
+    // keep their capacity from one copy to the next
+    _cellParticles.resize( grid._cellParticles.size() );
+
+    for ( int i=0 ; i<_cellParticles.size() ; ++i )
+    {
+        const QVector<unsigned int>& source = grid._cellParticles[i];
+        QVector<unsigned int>& cell = _cellParticles[i];
+
+        if ( cell.capacity() < source.size() )
+            cell.reserve( source.size() + source.size() / 2 );
+
+        cell.resize( source.size() );
+        std::copy( source.constBegin(), source.constEnd(), cell.begin() );
+    }
+}
+
 void Grid::addParticle( unsigned int cellIndex, unsigned int particleIndex )
 {
     _cellParticles[cellIndex].append( particleIndex );
@@ -105,3 +125,46 @@ const QVector<unsigned int>& Grid::cellParticles( unsigned int cell ) const
 {
     return _cellParticles[cell];
 }
+
+unsigned int Grid::nbNeighborhoodParticles( unsigned int cell ) const
+{
+    const QVector<unsigned int>& neighborhood = _neighborhoods[cell];
+    unsigned int nbParticles = 0;
+
+    for ( int i=0 ; i<neighborhood.size() ; ++i )
+        nbParticles += _cellParticles[neighborhood[i]].size();
+
+    return nbParticles;
+}
+
+unsigned int Grid::nbCells() const
+{
+    return _cellParticles.size();
+}
+
+size_t Grid::neighborhoodMemoryUsage() const
+{
+    size_t bytes = _neighborhoods.capacity() * sizeof( QVector<unsigned int> );
+
+    for ( int i=0 ; i<_neighborhoods.size() ; ++i )
+        bytes += _neighborhoods[i].capacity() * sizeof( unsigned int );
+
+    return bytes;
+}
+
+size_t Grid::cellMemoryUsage( const Grid* sharedGrid ) const
+{
+    // A copy of a grid shares the lists of the cells that did not change
+    // since, which are only counted with the other grid
+    if ( sharedGrid && _cellParticles.isSharedWith( sharedGrid->_cellParticles ) )
+        return 0;
+
+    size_t bytes = _cellParticles.capacity() * sizeof( QVector<unsigned int> );
+
+    for ( int i=0 ; i<_cellParticles.size() ; ++i )
+        if ( !sharedGrid || i >= sharedGrid->_cellParticles.size() ||
+             !_cellParticles[i].isSharedWith( sharedGrid->_cellParticles[i] ) )
+            bytes += _cellParticles[i].capacity() * sizeof( unsigned int );
+
+    return bytes;
+}
@@ -17,7 +17,12 @@ public:
 
     const QVector<unsigned int>& neighborhood( unsigned int cell ) const;
     const QVector<unsigned int>& cellParticles( unsigned int cell ) const;
+    unsigned int nbNeighborhoodParticles( unsigned int cell ) const;
+    unsigned int nbCells() const;
+    size_t neighborhoodMemoryUsage() const;
+    size_t cellMemoryUsage( const Grid* sharedGrid = 0 ) const;
 
+    void copyCells( const Grid& grid );
     void addParticle( unsigned int cellIndex, unsigned int particleIndex );
     void removeParticle( unsigned int cellIndex, unsigned int particleIndex );
     unsigned int cellIndex( const QVector3D& position ) const;
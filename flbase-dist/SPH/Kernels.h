@@ -0,0 +1,238 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cmath>
+
+/* The smoothing kernels used by the simulation. A family gives the three
+ * kernels of the SPH forces, all evaluated from the squared distance r2 < h^2:
+ *
+ *  - density( r2 ), the kernel W used for densities and surface tension;
+ *  - pressure( r2 ), the norm of its gradient divided by r, so that the
+ *    pressure gradient is 'difference * pressure( r2 )';
+ *  - viscosity( r2 ), the laplacian used by the viscosity.
+ *
+ * Families are plain classes with inline functions. SPH compiles its loops
+ * once per family ( see SPH::computeDensities ), so there is no virtual call
+ * in the inner loops and the coefficients are kept in registers.
+ *
+ * Only poly6 is a polynomial of r2. The other kernels need r, but the pressure
+ * and viscosity of the Wendland and cubic spline kernels are finite at r = 0
+ * and need no special case, unlike spiky's. Their viscosity is the laplacian
+ * approximation of Brookshaw, 2 |dW/dr| / r, which keeps the sign of a true
+ * viscosity whatever the shape of the kernel.
+ */
+
+// Poly6, spiky and viscosity kernels
+//
+// See M. Müller, D. Charypar et M. Gross. 2003
+//     Particle-based fluid simulation for interactive applications.
+class MullerKernels
+{
+public:
+    MullerKernels()
+        : _h( 0 ), _h2( 0 ), _coeffPoly6( 0 ), _coeffSpiky( 0 ), _coeffVisc( 0 )
+    {
+    }
+
+    explicit MullerKernels( float smoothingRadius )
+        : _h( smoothingRadius )
+        , _h2( smoothingRadius * smoothingRadius )
+    {
+        float h6 = _h2 * _h2 * _h2;
+        float h9 = h6 * _h2 * _h;
+
+        _coeffPoly6 = 315.0 / ( 64.0 * M_PI * h9 );
+        _coeffSpiky = 3.0 * 15.0 / ( M_PI * h6 );
+        _coeffVisc = 45.0 / ( M_PI * h6 );
+    }
+
+    float density( float r2 ) const
+    {
+        float diff = _h2 - r2;
+
+        return _coeffPoly6 * diff * diff * diff;
+    }
+
+    float pressure( float r2 ) const
+    {
+        float r = ::sqrt( r2 );
+
+        if ( r == 0 )
+            return 0;
+
+        float diff = _h - r;
+
+        return _coeffSpiky * diff * diff / r;
+    }
+
+    float viscosity( float r2 ) const
+    {
+        float r = ::sqrt( r2 );
+
+        return _coeffVisc * ( _h - r );
+    }
+
+private:
+    float _h;
+    float _h2;
+    float _coeffPoly6;
+    float _coeffSpiky;
+    float _coeffVisc;
+};
+
+// Wendland C2 kernel
+//
+// See W. Dehnen et H. Aly. 2012
+//     Improving convergence in smoothed particle hydrodynamics simulations
+//     without pairing instability.
+class WendlandC2Kernels
+{
+public:
+    WendlandC2Kernels()
+        : _invH( 0 ), _coeffDensity( 0 ), _coeffGradient( 0 )
+    {
+    }
+
+    explicit WendlandC2Kernels( float smoothingRadius )
+        : _invH( 1 / smoothingRadius )
+    {
+        float h3 = smoothingRadius * smoothingRadius * smoothingRadius;
+        float h5 = h3 * smoothingRadius * smoothingRadius;
+
+        _coeffDensity = 21.0 / ( 2.0 * M_PI * h3 );
+        _coeffGradient = 210.0 / ( M_PI * h5 );
+    }
+
+    float density( float r2 ) const
+    {
+        float q = ::sqrt( r2 ) * _invH;
+        float diff = 1 - q;
+        float diff2 = diff * diff;
+
+        return _coeffDensity * diff2 * diff2 * ( 1 + 4 * q );
+    }
+
+    float pressure( float r2 ) const
+    {
+        float diff = 1 - ::sqrt( r2 ) * _invH;
+
+        return _coeffGradient * diff * diff * diff;
+    }
+
+    float viscosity( float r2 ) const
+    {
+        return 2 * pressure( r2 );
+    }
+
+private:
+    float _invH;
+    float _coeffDensity;
+    float _coeffGradient;
+};
+
+// Wendland C4 kernel, smoother and wider than C2 for the same support
+//
+// See W. Dehnen et H. Aly. 2012
+class WendlandC4Kernels
+{
+public:
+    WendlandC4Kernels()
+        : _invH( 0 ), _coeffDensity( 0 ), _coeffGradient( 0 )
+    {
+    }
+
+    explicit WendlandC4Kernels( float smoothingRadius )
+        : _invH( 1 / smoothingRadius )
+    {
+        float h3 = smoothingRadius * smoothingRadius * smoothingRadius;
+        float h5 = h3 * smoothingRadius * smoothingRadius;
+
+        _coeffDensity = 495.0 / ( 32.0 * M_PI * h3 );
+        _coeffGradient = 1155.0 / ( 4.0 * M_PI * h5 );
+    }
+
+    float density( float r2 ) const
+    {
+        float q = ::sqrt( r2 ) * _invH;
+        float diff = 1 - q;
+        float diff3 = diff * diff * diff;
+
+        return _coeffDensity * diff3 * diff3 * ( 1 + 6 * q + ( 35.0f / 3 ) * q * q );
+    }
+
+    float pressure( float r2 ) const
+    {
+        float q = ::sqrt( r2 ) * _invH;
+        float diff = 1 - q;
+        float diff2 = diff * diff;
+
+        return _coeffGradient * diff2 * diff2 * diff * ( 1 + 5 * q );
+    }
+
+    float viscosity( float r2 ) const
+    {
+        return 2 * pressure( r2 );
+    }
+
+private:
+    float _invH;
+    float _coeffDensity;
+    float _coeffGradient;
+};
+
+// Cubic spline kernel, with its support scaled to h
+//
+// See J. J. Monaghan. 1992
+//     Smoothed particle hydrodynamics.
+class CubicSplineKernels
+{
+public:
+    CubicSplineKernels()
+        : _invH( 0 ), _coeffDensity( 0 ), _coeffGradient( 0 )
+    {
+    }
+
+    explicit CubicSplineKernels( float smoothingRadius )
+        : _invH( 1 / smoothingRadius )
+    {
+        float h3 = smoothingRadius * smoothingRadius * smoothingRadius;
+        float h5 = h3 * smoothingRadius * smoothingRadius;
+
+        _coeffDensity = 8.0 / ( M_PI * h3 );
+        _coeffGradient = 8.0 / ( M_PI * h5 );
+    }
+
+    float density( float r2 ) const
+    {
+        float q = ::sqrt( r2 ) * _invH;
+        float diff = 1 - q;
+
+        if ( q <= 0.5f )
+            return _coeffDensity * ( 1 + 6 * q * q * ( q - 1 ) );
+
+        return _coeffDensity * 2 * diff * diff * diff;
+    }
+
+    float pressure( float r2 ) const
+    {
+        float q = ::sqrt( r2 ) * _invH;
+        float diff = 1 - q;
+
+        if ( q <= 0.5f )
+            return _coeffGradient * ( 12 - 18 * q );
+
+        return _coeffGradient * 6 * diff * diff / q;
+    }
+
+    float viscosity( float r2 ) const
+    {
+        return 2 * pressure( r2 );
+    }
+
+private:
+    float _invH;
+    float _coeffDensity;
+    float _coeffGradient;
+};
+
+#endif // KERNELS_H
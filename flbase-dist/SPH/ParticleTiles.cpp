@@ -0,0 +1,122 @@
+#include "ParticleTiles.h"
+
+ParticleTiles::ParticleTiles()
+{
+}
+
+void ParticleTiles::packPositions( const Particles& particles, const Grid& grid )
+{
+    int nbCells = grid.nbCells();
+    int nbParticles = particles.size();
+
+    _cellStarts.resize( nbCells + 1 );
+    _indices.resize( nbParticles );
+    _masses.resize( nbParticles );
+    _densities.resize( nbParticles );
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        _positions[i].resize( nbParticles );
+
+    _cellStarts[0] = 0;
+
+    for ( int cell=0 ; cell<nbCells ; ++cell )
+        _cellStarts[cell + 1] = _cellStarts[cell] + grid.cellParticles( cell ).size();
+
+#pragma omp parallel for schedule( guided )
+    for ( int cell=0 ; cell<nbCells ; ++cell )
+    {
+        const QVector<unsigned int>& cellParticles = grid.cellParticles( cell );
+        unsigned int current = _cellStarts[cell];
+
+        for ( int k=0 ; k<cellParticles.size() ; ++k, ++current )
+        {
+            const Particle& particle = particles[cellParticles[k]];
+
+            _indices[current] = cellParticles[k];
+            _positions[0][current] = particle.position().x();
+            _positions[1][current] = particle.position().y();
+            _positions[2][current] = particle.position().z();
+            _masses[current] = particle.mass();
+            _densities[current] = particle.density();
+        }
+    }
+}
+
+void ParticleTiles::packForces( const Particles& particles )
+{
+    int nbParticles = _indices.size();
+
+    _pressures.resize( nbParticles );
+    _volumes.resize( nbParticles );
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        _velocities[i].resize( nbParticles );
+
+#pragma omp parallel for schedule( static )
+    for ( int current=0 ; current<nbParticles ; ++current )
+    {
+        const Particle& particle = particles[_indices[current]];
+
+        _velocities[0][current] = particle.velocity().x();
+        _velocities[1][current] = particle.velocity().y();
+        _velocities[2][current] = particle.velocity().z();
+        _pressures[current] = particle.pressure();
+        _volumes[current] = particle.volume();
+    }
+}
+
+unsigned int ParticleTiles::begin( unsigned int cell ) const
+{
+    return _cellStarts[cell];
+}
+
+unsigned int ParticleTiles::end( unsigned int cell ) const
+{
+    return _cellStarts[cell + 1];
+}
+
+const unsigned int* ParticleTiles::indices() const
+{
+    return _indices.constData();
+}
+
+const float* ParticleTiles::positions( unsigned int coord ) const
+{
+    return _positions[coord].constData();
+}
+
+const float* ParticleTiles::masses() const
+{
+    return _masses.constData();
+}
+
+const float* ParticleTiles::densities() const
+{
+    return _densities.constData();
+}
+
+const float* ParticleTiles::velocities( unsigned int coord ) const
+{
+    return _velocities[coord].constData();
+}
+
+const float* ParticleTiles::pressures() const
+{
+    return _pressures.constData();
+}
+
+const float* ParticleTiles::volumes() const
+{
+    return _volumes.constData();
+}
+
+size_t ParticleTiles::memoryUsage() const
+{
+    size_t bytes = ( _cellStarts.capacity() + _indices.capacity() ) * sizeof( unsigned int );
+    bytes += ( _masses.capacity() + _densities.capacity() + _pressures.capacity() + _volumes.capacity() ) * sizeof( float );
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        bytes += ( _positions[i].capacity() + _velocities[i].capacity() ) * sizeof( float );
+
+    return bytes;
+}
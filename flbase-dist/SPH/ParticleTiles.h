@@ -0,0 +1,51 @@
+#ifndef PARTICLETILES_H
+#define PARTICLETILES_H
+
+#include "SPH/Grid.h"
+#include "SPH/Particles.h"
+#include <QVector>
+
+/* The particles sorted by cell, as a structure of arrays. The particles of a
+ * cell form a contiguous tile, so the interactions between a cell and each
+ * cell of its neighborhood ( see SPH::computeDensities ) read two small tiles
+ * that stay in the cache for all their pairs, instead of gathering every
+ * neighbor of every particle from the particle array.
+ *
+ * 'packPositions' sorts the particles and packs what the densities need,
+ * 'packForces' adds, in the same order, what the forces need once the
+ * densities are known.
+ */
+
+class ParticleTiles
+{
+public:
+    ParticleTiles();
+
+    void packPositions( const Particles& particles, const Grid& grid );
+    void packForces( const Particles& particles );
+
+    unsigned int begin( unsigned int cell ) const;
+    unsigned int end( unsigned int cell ) const;
+    const unsigned int* indices() const;
+
+    const float* positions( unsigned int coord ) const;
+    const float* masses() const;
+    const float* densities() const;
+    const float* velocities( unsigned int coord ) const;
+    const float* pressures() const;
+    const float* volumes() const;
+
+    size_t memoryUsage() const;
+
+private:
+    QVector<unsigned int> _cellStarts;
+    QVector<unsigned int> _indices;
+    QVector<float> _positions[3];
+    QVector<float> _masses;
+    QVector<float> _densities;
+    QVector<float> _velocities[3];
+    QVector<float> _pressures;
+    QVector<float> _volumes;
+};
+
+#endif // PARTICLETILES_H
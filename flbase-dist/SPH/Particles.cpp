@@ -9,29 +9,17 @@ namespace
 
 Particles::Particles( unsigned int nbParticles )
     : QVector<Particle>( nbParticles )
-    , _vertexBuffer( QGLBuffer::VertexBuffer )
-    , _normalBuffer( QGLBuffer::VertexBuffer )
-    , _indexBuffer( QGLBuffer::IndexBuffer )
-    , _nbIndices( 0 )
+    , _isMeshCreated( false )
 {
 }
 
 void Particles::render( const QMatrix4x4& transformation, GLShader& shader )
 {
-    if ( !_indexBuffer.isCreated() )
-        createOpenGLBuffers();
+    if ( !_isMeshCreated )
+        createMesh();
 
-    _vertexBuffer.bind();
-    shader.setVertexAttributeBuffer();
-    shader.enableVertexAttributeArray();
-    _vertexBuffer.release();
-
-    _normalBuffer.bind();
-    shader.setNormalAttributeBuffer();
-    shader.enableNormalAttributeArray();
-    _normalBuffer.release();
-
-    _indexBuffer.bind();
+    MeshPool& meshPool = MeshPool::meshPool();
+    meshPool.bind( shader );
 
     for ( int i=0 ; i<size() ; ++i )
     {
@@ -43,22 +31,21 @@ void Particles::render( const QMatrix4x4& transformation, GLShader& shader )
         translation.setColumn( 3, QVector4D( particle.position(), 1 ) );
         shader.setGlobalTransformation( transformation * translation );
 
-        glDrawElements( GL_TRIANGLES, _nbIndices, GL_UNSIGNED_INT, 0 );
+        meshPool.draw( _mesh );
     }
 
-    _indexBuffer.release();
-
-    shader.disableVertexAttributeArray();
-    shader.disableNormalAttributeArray();
+    meshPool.release( shader );
 }
 
-void Particles::createOpenGLBuffers()
+void Particles::createMesh()
 {
-    createVerticesNormals();
-    createIndices();
+    // On a unit sphere, the normals are the vertices
+    QVector<QVector3D> vertices = createVertices();
+    _mesh = MeshPool::meshPool().add( vertices, vertices, createIndices() );
+    _isMeshCreated = true;
 }
 
-void Particles::createVerticesNormals()
+QVector<QVector3D> Particles::createVertices() const
 {
     QVector<QVector3D> vertices;
 
@@ -79,11 +66,10 @@ void Particles::createVerticesNormals()
     // Top vertex
     vertices.append( QVector3D( 0, 1, 0 ) );
 
-    createVertexBuffer( vertices );
-    createNormalBuffer( vertices );
+    return vertices;
 }
 
-void Particles::createIndices()
+QVector<unsigned int> Particles::createIndices() const
 {
     QVector<unsigned int> indices;
 
@@ -130,34 +116,5 @@ void Particles::createIndices()
         indices.append(  lastVertex - nbThetas + ( i + 1 ) % nbThetas );
     }
 
-    createIndexBuffer( indices );
-}
-
-void Particles::createVertexBuffer( const QVector<QVector3D>& vertices )
-{
-    _vertexBuffer.create();
-    _vertexBuffer.bind();
-    _vertexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-    _vertexBuffer.allocate( &vertices[0], vertices.size() * sizeof( vertices[0] ) );
-    _vertexBuffer.release();
-}
-
-void Particles::createNormalBuffer( const QVector<QVector3D>& normals )
-{
-    _normalBuffer.create();
-    _normalBuffer.bind();
-    _normalBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-    _normalBuffer.allocate( &normals[0], normals.size() * sizeof( normals[0] ) );
-    _normalBuffer.release();
-}
-
-void Particles::createIndexBuffer( const QVector<unsigned int>& indices )
-{
-    _indexBuffer.create();
-    _indexBuffer.bind();
-    _indexBuffer.setUsagePattern( QGLBuffer::StaticDraw );
-    _indexBuffer.allocate( &indices[0], indices.size() * sizeof( indices[0] ) );
-    _indexBuffer.release();
-
-    _nbIndices = indices.size();
+    return indices;
 }
@@ -2,8 +2,8 @@
 #define PARTICLES_H
 
 #include "SPH/Particle.h"
+#include "Geometry/MeshPool.h"
 #include "GLShader.h"
-#include <QGLBuffer>
 
 #define M_PI 3.14159265358979323846264338327950288
 
@@ -18,18 +18,13 @@ public:
     void render( const QMatrix4x4& transformation, GLShader& shader );
 
 private:
-    void createOpenGLBuffers();
-    void createVerticesNormals();
-    void createIndices();
-    void createVertexBuffer( const QVector<QVector3D>& vertices );
-    void createNormalBuffer( const QVector<QVector3D>& normals );
-    void createIndexBuffer( const QVector<unsigned int>& indices );
+    void createMesh();
+    QVector<QVector3D> createVertices() const;
+    QVector<unsigned int> createIndices() const;
 
 private:
-    QGLBuffer _vertexBuffer;
-    QGLBuffer _normalBuffer;
-    QGLBuffer _indexBuffer;
-    unsigned int _nbIndices;
+    MeshPool::Mesh _mesh;
+    bool _isMeshCreated;
 };
 
 #endif // PARTICLESET_H
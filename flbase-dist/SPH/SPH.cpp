@@ -1,7 +1,68 @@
 #include "SPH.h"
+#include "FrameArena.h"
+#include "LiveMetrics.h"
+#include "MemoryFootprint.h"
+#include "Profiler.h"
+#include "SPH/Prefetch.h"
+#include <algorithm>
 #include <cmath>
 #include <QDebug>
 
+namespace
+{
+    // Anisotropic surface reconstruction ( see AnisotropicKernel )
+    static float centerSmoothing = 0.9;
+    static unsigned int minAnisotropicNeighbors = 8;
+
+    // Distance a particle may move before the surface around it is rebuilt,
+    // relative to the smoothing radius
+    static float surfaceTolerance = 0.05;
+
+    // Threads of the surface loops on the surface thread. It runs beside the
+    // team of the simulation, which already has every core, and a team of its
+    // own as large would double the threads. One thread keeps it serial: the
+    // simulation does not wait for it, and shows the previous mesh meanwhile.
+    static int surfaceThreadTeam = 1;
+
+    // Radius of the spheres drawn by the screen space renderer, relative to
+    // the smoothing radius
+    static float splatRadius = 0.5;
+
+    // How many neighbor cells ahead the density and surface loops prefetch.
+    // Further ahead was slower, the cells of a neighborhood being mostly
+    // consecutive runs the hardware already prefetches.
+    static int cellPrefetchDistance = 1;
+
+    // Implicit viscosity ( see SPH::solveViscosity )
+    static unsigned int maxViscosityIterations = 50;
+    static float viscosityTolerance = 1e-4;
+
+    // Dot products of the x, y and z components, which are solved separately
+    QVector3D componentDot( const QVector3D* a, const QVector3D* b, int size )
+    {
+        double x = 0;
+        double y = 0;
+        double z = 0;
+
+#pragma omp parallel for reduction( +:x, y, z )
+        for ( int i=0 ; i<size ; ++i )
+        {
+            x += a[i].x() * b[i].x();
+            y += a[i].y() * b[i].y();
+            z += a[i].z() * b[i].z();
+        }
+
+        return QVector3D( x, y, z );
+    }
+
+    QVector3D componentRatio( const QVector3D& a, const QVector3D& b )
+    {
+        return QVector3D( ( b.x() != 0 ) ? a.x() / b.x() : 0,
+                          ( b.y() != 0 ) ? a.y() / b.y() : 0,
+                          ( b.z() != 0 ) ? a.z() / b.z() : 0 );
+    }
+}
+
 SPH::SPH( AbstractObject* parent, const Geometry& container, float smoothingRadius, float viscosity, float pressure, float surfaceTension,
           unsigned int nbCellX, unsigned int nbCellY, unsigned int nbCellZ, unsigned int nbCubeX,
           unsigned int nbCubeY, unsigned int nbCubeZ, unsigned int nbParticles, float restDensity,
@@ -9,9 +70,9 @@ SPH::SPH( AbstractObject* parent, const Geometry& container, float smoothingRadi
     : AbstractObject( parent )
     , _container( container )
     , _coeffPoly6( 0 )
-    , _coeffSpiky( 0 )
-    , _coeffVisc( 0 )
     , _restDensity( restDensity )
+    , _kernelFamily( MullerKernelFamily )
+    , _isKernelTabulated( false )
     , _smoothingRadius( smoothingRadius )
     , _smoothingRadius2( smoothingRadius * smoothingRadius )
     , _viscosity( viscosity )
@@ -21,9 +82,28 @@ SPH::SPH( AbstractObject* parent, const Geometry& container, float smoothingRadi
     , _gravity( gravity )
     , _particles( nbParticles )
     , _grid( inflatedContainerBoundingBox(), nbCellX, nbCellY, nbCellZ, smoothingRadius )
+    , _neighbors( 0 )
+    , _nbNeighbors( 0 )
+    , _neighborSlots( 0 )
+    , _isViscosityImplicit( false )
+    , _viscosityWeights( 0 )
+    , _viscosityCorrections( 0 )
+    , _isLoadBalanced( true )
+    , _integrator( SemiImplicitEulerIntegrator )
+    , _pendingHalfDeltaTime( 0 )
     , _marchingTetrahedra( inflatedContainerBoundingBox(), nbCubeX, nbCubeY, nbCubeZ )
+    , _adaptiveMarchingTetrahedra( inflatedContainerBoundingBox(), ( nbCubeX + 3 ) / 4, ( nbCubeY + 3 ) / 4, ( nbCubeZ + 3 ) / 4, 3 )
     , _renderMode( RenderParticles )
+    , _anisotropicSurface( true )
+    , _adaptiveSurface( false )
+    , _surfaceKernels( nbParticles )
+    , _surfacePositions( nbParticles )
     , _material( QColor( 128, 128, 128, 255 ) )
+    , _surfaceGrid( _grid )
+    , _threadedSurface( true )
+    , _surfaceInterval( 1 )
+    , _nbStepsSinceSurface( 0 )
+    , _surfaceThread( *this )
 {
     initializeCoefficients();
     initializeParticles( totalVolume );
@@ -41,9 +121,25 @@ void SPH::animate( const TimeState& timeState )
     if ( deltaTime > _maxDeltaTime )
         deltaTime = _maxDeltaTime;
 
+    // For the hardware counters per particle
+    Profiler::profiler().setNbParticles( _particles.size() );
+
+    if ( _integrator == LeapfrogIntegrator )
+        synchronizeVelocities();
+
     computeDensities();
     computeForces();
+
+    if ( _isViscosityImplicit )
+        solveViscosity( deltaTime );
+
     moveParticles( deltaTime );
+    recordMemoryUsage();
+
+    if ( LiveMetrics::liveMetrics().isEnabled() )
+        recordLiveMetrics( deltaTime );
+
+    ++_nbStepsSinceSurface;
 }
 
 void SPH::render( GLShader& shader )
@@ -53,18 +149,98 @@ void SPH::render( GLShader& shader )
     switch( _renderMode )
     {
     case RenderParticles : _particles.render( globalTransformation(), shader ); break;
-    case RenderImplicitSurface : _marchingTetrahedra.render( globalTransformation(), shader, *this ); break;
+    case RenderImplicitSurface :
+        if ( _adaptiveSurface )
+        {
+            _surfaceThread.waitUntilIdle();
+            ProfilerScope profilerScope( Profiler::Surface );
+            takeSurfaceSnapshot();
+            computeSurfaceKernels();
+            _adaptiveMarchingTetrahedra.render( globalTransformation(), shader, *this );
+            recordSurfaceMemoryUsage();
+            MemoryFootprint::memoryFootprint().record( MemoryFootprint::AdaptiveLattice,
+                                                       _adaptiveMarchingTetrahedra.latticeMemoryUsage() );
+        }
+        else if ( _threadedSurface )
+        {
+            // Show the newest completed mesh, and start the next one
+            if ( !_surfaceThread.isBusy() )
+            {
+                _marchingTetrahedra.upload();
+
+                if ( _nbStepsSinceSurface >= _surfaceInterval )
+                {
+                    takeSurfaceSnapshot();
+                    _surfaceThread.request();
+                }
+            }
+
+            _marchingTetrahedra.draw( globalTransformation(), shader );
+        }
+        else
+        {
+            takeSurfaceSnapshot();
+            extractSurface( FrameArena::frameArena() );
+            _marchingTetrahedra.upload();
+            _marchingTetrahedra.draw( globalTransformation(), shader );
+        }
+        break;
+    case RenderScreenSpace :
+        _screenSpaceFluid.render( _particles, splatRadius * _smoothingRadius, globalTransformation(), shader, _material );
+        break;
     }
+
+    // The buffers are only modified here, with the OpenGL context
+    MemoryFootprint::memoryFootprint().record( MemoryFootprint::GLBuffers, _marchingTetrahedra.bufferMemoryUsage() +
+                                                                           _screenSpaceFluid.bufferMemoryUsage() );
 }
 
 void SPH::changeRenderMode()
 {
     if ( _renderMode == RenderParticles )
         _renderMode = RenderImplicitSurface;
+    else if ( _renderMode == RenderImplicitSurface )
+        _renderMode = RenderScreenSpace;
     else
         _renderMode = RenderParticles;
 }
 
+void SPH::setRenderMode( RenderMode renderMode )
+{
+    _renderMode = renderMode;
+}
+
+void SPH::changeSurfaceKernel()
+{
+    _surfaceThread.waitUntilIdle();
+    _anisotropicSurface = !_anisotropicSurface;
+    _marchingTetrahedra.invalidateAll();
+    _nbStepsSinceSurface = _surfaceInterval;
+}
+
+void SPH::changeSurfaceExtraction()
+{
+    _adaptiveSurface = !_adaptiveSurface;
+    _nbStepsSinceSurface = _surfaceInterval;
+}
+
+void SPH::changeSurfaceThreading()
+{
+    _surfaceThread.waitUntilIdle();
+    _threadedSurface = !_threadedSurface;
+}
+
+void SPH::setSurfaceThreaded( bool threadedSurface )
+{
+    _surfaceThread.waitUntilIdle();
+    _threadedSurface = threadedSurface;
+}
+
+void SPH::setSurfaceInterval( unsigned int nbSteps )
+{
+    _surfaceInterval = nbSteps;
+}
+
 void SPH::changeMaterial()
 {
     if ( _material.refractiveIndex() == 1 )
@@ -73,6 +249,125 @@ void SPH::changeMaterial()
         _material = Material( QColor( 128, 128, 128, 255 ) );
 }
 
+void SPH::changeKernelFamily()
+{
+    setKernelFamily( KernelFamily( ( _kernelFamily + 1 ) % NbKernelFamilies ) );
+}
+
+void SPH::setKernelFamily( KernelFamily kernelFamily )
+{
+    _kernelFamily = kernelFamily;
+    tabulateKernels();
+}
+
+SPH::KernelFamily SPH::kernelFamily() const
+{
+    return _kernelFamily;
+}
+
+void SPH::changeViscositySolver()
+{
+    _isViscosityImplicit = !_isViscosityImplicit;
+}
+
+void SPH::setViscosityImplicit( bool isViscosityImplicit )
+{
+    _isViscosityImplicit = isViscosityImplicit;
+}
+
+void SPH::changeLoadBalancing()
+{
+    _isLoadBalanced = !_isLoadBalanced;
+
+    // So that the idle times are the ones of the new partition
+    Profiler::profiler().resetThreadTimes();
+}
+
+void SPH::setLoadBalanced( bool isLoadBalanced )
+{
+    _isLoadBalanced = isLoadBalanced;
+}
+
+void SPH::changeKernelTabulation()
+{
+    _isKernelTabulated = !_isKernelTabulated;
+}
+
+void SPH::setKernelTabulated( bool isKernelTabulated )
+{
+    _isKernelTabulated = isKernelTabulated;
+}
+
+void SPH::setMaxDeltaTime( float maxDeltaTime )
+{
+    _maxDeltaTime = maxDeltaTime;
+}
+
+float SPH::maxDeltaTime() const
+{
+    return _maxDeltaTime;
+}
+
+void SPH::changeIntegrator()
+{
+    setIntegrator( Integrator( ( _integrator + 1 ) % NbIntegrators ) );
+}
+
+void SPH::setIntegrator( Integrator integrator )
+{
+    // The velocities are used as they are as the ones of the start of the step
+    _integrator = integrator;
+    _pendingHalfDeltaTime = 0;
+}
+
+SPH::Integrator SPH::integrator() const
+{
+    return _integrator;
+}
+
+const Particles& SPH::particles() const
+{
+    return _particles;
+}
+
+quint64 SPH::nbNeighborPairs() const
+{
+    quint64 nbPairs = 0;
+
+    if ( _nbNeighbors )
+        for ( int i=0 ; i<_particles.size() ; ++i )
+            nbPairs += _nbNeighbors[i];
+
+    return nbPairs;
+}
+
+float SPH::smoothingRadius() const
+{
+    return _smoothingRadius;
+}
+
+const char* SPH::kernelFamilyName( KernelFamily kernelFamily )
+{
+    switch ( kernelFamily )
+    {
+    case MullerKernelFamily : return "muller";
+    case WendlandC2KernelFamily : return "wendlandC2";
+    case WendlandC4KernelFamily : return "wendlandC4";
+    case CubicSplineKernelFamily : return "cubicSpline";
+    default : return "";
+    }
+}
+
+const char* SPH::integratorName( Integrator integrator )
+{
+    switch ( integrator )
+    {
+    case SemiImplicitEulerIntegrator : return "euler";
+    case LeapfrogIntegrator : return "leapfrog";
+    default : return "";
+    }
+}
+
 void SPH::resetVelocities()
 {
     for ( int i=0 ; i<_particles.size() ; ++i )
@@ -94,14 +389,14 @@ void SPH::initializeCoefficients()
     float h6 = _smoothingRadius2 * _smoothingRadius2 * _smoothingRadius2;
     float h9 = h6 * _smoothingRadius2 * _smoothingRadius;
 
-    // Poly6
+    // Poly6, for the surface
     _coeffPoly6 = 315.0 / ( 64.0 * M_PI * h9 );
 
-    // Spiky
-    _coeffSpiky = 3.0 * 15.0 / ( M_PI * h6 );
-
-    // Visc
-    _coeffVisc = 45.0 / ( M_PI * h6 );
+    _mullerKernels = MullerKernels( _smoothingRadius );
+    _wendlandC2Kernels = WendlandC2Kernels( _smoothingRadius );
+    _wendlandC4Kernels = WendlandC4Kernels( _smoothingRadius );
+    _cubicSplineKernels = CubicSplineKernels( _smoothingRadius );
+    tabulateKernels();
 }
 
 void SPH::initializeParticles( float totalVolume )
@@ -117,6 +412,7 @@ void SPH::initializeParticles( float totalVolume )
         _particles[i].setVolume( mass / _restDensity );
         _particles[i].setPosition( _container.randomInteriorPoint() );
         _particles[i].setCellIndex( _grid.cellIndex( _particles[i].position() ) );
+        _surfacePositions[i] = _particles[i].position();
 
         _grid.addParticle( _particles[i].cellIndex(), i );
     }
@@ -136,125 +432,493 @@ float SPH::densitykernelGradient( float r2 ) const
     return -3 * _coeffPoly6 * diff * diff;
 }
 
-float SPH::pressureKernel( float r ) const
+float SPH::pressure( float density ) const
 {
-    if ( r == 0 )
-        return 0;
-
-    float diff = _smoothingRadius - r;
-
-    return _coeffSpiky * diff * diff / r;
+    return density / _restDensity - 1;
 }
 
-float SPH::viscosityKernel( float r ) const
+void SPH::tabulateKernels()
 {
-    return _coeffVisc * ( _smoothingRadius - r );
+    switch ( _kernelFamily )
+    {
+    case MullerKernelFamily : _tabulatedKernels = TabulatedKernels( _mullerKernels, _smoothingRadius ); break;
+    case WendlandC2KernelFamily : _tabulatedKernels = TabulatedKernels( _wendlandC2Kernels, _smoothingRadius ); break;
+    case WendlandC4KernelFamily : _tabulatedKernels = TabulatedKernels( _wendlandC4Kernels, _smoothingRadius ); break;
+    case CubicSplineKernelFamily : _tabulatedKernels = TabulatedKernels( _cubicSplineKernels, _smoothingRadius ); break;
+    default : break;
+    }
 }
 
-float SPH::pressure( float density ) const
+void SPH::computeDensities()
 {
-    return density / _restDensity - 1;
+    ProfilerScope profilerScope( Profiler::Densities );
+
+    if ( _isKernelTabulated )
+        computeDensities( _tabulatedKernels );
+    else
+    {
+        switch ( _kernelFamily )
+        {
+        case MullerKernelFamily : computeDensities( _mullerKernels ); break;
+        case WendlandC2KernelFamily : computeDensities( _wendlandC2Kernels ); break;
+        case WendlandC4KernelFamily : computeDensities( _wendlandC4Kernels ); break;
+        case CubicSplineKernelFamily : computeDensities( _cubicSplineKernels ); break;
+        default : break;
+        }
+    }
 }
 
-void SPH::computeDensities()
+template <class Kernels>
+void SPH::computeDensities( const Kernels& kernels )
 {
-    // For each particle
-#pragma omp parallel for schedule( guided )
-    for ( int i=0 ; i<_particles.size() ; ++i )
+    _tiles.packPositions( _particles, _grid );
+
+    _neighbors = FrameArena::frameArena().allocate<const unsigned int*>( _particles.size() );
+    _nbNeighbors = FrameArena::frameArena().allocate<unsigned int>( _particles.size() );
+    _neighborSlots = FrameArena::frameArena().allocate<const unsigned int*>( _particles.size() );
+
+    const unsigned int* indices = _tiles.indices();
+    const float* x = _tiles.positions( 0 );
+    const float* y = _tiles.positions( 1 );
+    const float* z = _tiles.positions( 2 );
+    const float* masses = _tiles.masses();
+    const float* densities = _tiles.densities();
+
+    // The work of a cell is its number of candidate pairs
+    int nbCells = _grid.nbCells();
+
+    if ( _isLoadBalanced )
     {
-        float density = 0;
-        float correction = 0;
-        Particle& particle = _particles[i];
-        const QVector<unsigned int>& neighborhood = _grid.neighborhood( particle.cellIndex() );
+        _workCosts.resize( nbCells );
 
-        // For each neighbor cell
-        for ( int j=0 ; j<neighborhood.size() ; ++j )
+#pragma omp parallel for schedule( static )
+        for ( int cell=0 ; cell<nbCells ; ++cell )
         {
-            const QVector<unsigned int>& neighbors = _grid.cellParticles( neighborhood[j] );
+            unsigned int nbCellParticles = _tiles.end( cell ) - _tiles.begin( cell );
+            _workCosts[cell] = ( nbCellParticles > 0 ) ? nbCellParticles * _grid.nbNeighborhoodParticles( cell ) : 0;
+        }
 
-            // For each particle in a neighboring cell
-            for ( int k=0 ; k<neighbors.size() ; ++k )
+        _cellPartition.balance( _workCosts.constData(), nbCells );
+    }
+    else
+        _cellPartition.split( nbCells );
+
+    // For each cell, against each cell of its neighborhood ( see ParticleTiles )
+#pragma omp parallel
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+#pragma omp for schedule( guided ) nowait
+        for ( int range=0 ; range<_cellPartition.nbRanges() ; ++range )
+        {
+            unsigned int rangeEnd = _cellPartition.end( range );
+
+            for ( unsigned int cell=_cellPartition.begin( range ) ; cell<rangeEnd ; ++cell )
             {
-                const Particle& neighbor = _particles[neighbors[k]];
-                QVector3D difference = particle.position() - neighbor.position();
-                float r2 = difference.lengthSquared();
+                unsigned int begin = _tiles.begin( cell );
+                unsigned int nbCellParticles = _tiles.end( cell ) - begin;
 
-                // If the neighboring particle is inside a sphere of radius 'h'
-                if ( r2 < _smoothingRadius2 )
+                if ( nbCellParticles == 0 )
+                    continue;
+
+                const QVector<unsigned int>& neighborhood = _grid.neighborhood( cell );
+                FrameArena& arena = FrameArena::threadArena();
+                float* cellDensities = arena.allocate<float>( nbCellParticles );
+                float* corrections = arena.allocate<float>( nbCellParticles );
+                unsigned int* nbNeighbors = arena.allocate<unsigned int>( nbCellParticles );
+
+                // Room for every candidate of every particle of the cell, compacted
+                // once the real neighbors are known
+                unsigned int capacity = _grid.nbNeighborhoodParticles( cell );
+                unsigned int* neighborLists = arena.allocate<unsigned int>( nbCellParticles * capacity );
+
+                for ( unsigned int a=0 ; a<nbCellParticles ; ++a )
+                {
+                    cellDensities[a] = 0;
+                    corrections[a] = 0;
+                    nbNeighbors[a] = 0;
+                }
+
+                // For each neighbor cell
+                for ( int j=0 ; j<neighborhood.size() ; ++j )
                 {
-                    // Add density contribution
-                    float kernelMass = densityKernel( r2 ) * neighbor.mass();
-                    density += kernelMass;
-                    correction += kernelMass / neighbor.density();
+                    unsigned int neighborsBegin = _tiles.begin( neighborhood[j] );
+                    unsigned int neighborsEnd = _tiles.end( neighborhood[j] );
+
+                    // The tile of a later cell is loaded while this one is processed
+                    if ( j + cellPrefetchDistance < neighborhood.size() )
+                    {
+                        unsigned int later = _tiles.begin( neighborhood[j + cellPrefetchDistance] );
+                        prefetch( x + later );
+                        prefetch( y + later );
+                        prefetch( z + later );
+                        prefetch( masses + later );
+                        prefetch( densities + later );
+                    }
+
+                    // For each pair of particles of the two tiles
+                    for ( unsigned int a=0 ; a<nbCellParticles ; ++a )
+                    {
+                        unsigned int i = begin + a;
+                        unsigned int* neighborList = neighborLists + a * capacity;
+
+                        for ( unsigned int k=neighborsBegin ; k<neighborsEnd ; ++k )
+                        {
+                            float dx = x[i] - x[k];
+                            float dy = y[i] - y[k];
+                            float dz = z[i] - z[k];
+                            float r2 = dx * dx + dy * dy + dz * dz;
+
+                            // If the neighboring particle is inside a sphere of radius 'h'
+                            if ( r2 < _smoothingRadius2 )
+                            {
+                                // Add density contribution
+                                float kernelMass = kernels.density( r2 ) * masses[k];
+                                cellDensities[a] += kernelMass;
+                                corrections[a] += kernelMass / densities[k];
+                                neighborList[nbNeighbors[a]++] = k;
+                            }
+                        }
+                    }
+                }
+
+                // Compact the lists of the slots of the neighbors, then translate them
+                // to the particle indices
+                unsigned int* compactedSlots = neighborLists;
+
+                for ( unsigned int a=0 ; a<nbCellParticles ; ++a )
+                {
+                    const unsigned int* neighborList = neighborLists + a * capacity;
+
+                    for ( unsigned int k=0 ; k<nbNeighbors[a] ; ++k )
+                        compactedSlots[k] = neighborList[k];
+
+                    _neighborSlots[begin + a] = compactedSlots;
+                    compactedSlots += nbNeighbors[a];
+                }
+
+                unsigned int nbPairs = compactedSlots - neighborLists;
+                arena.shrinkLast( neighborLists, nbPairs * sizeof( unsigned int ) );
+                unsigned int* neighborIndices = arena.allocate<unsigned int>( nbPairs );
+
+                for ( unsigned int k=0 ; k<nbPairs ; ++k )
+                    neighborIndices[k] = indices[neighborLists[k]];
+
+                for ( unsigned int a=0 ; a<nbCellParticles ; ++a )
+                {
+                    unsigned int index = indices[begin + a];
+                    _neighbors[index] = neighborIndices;
+                    _nbNeighbors[index] = nbNeighbors[a];
+                    neighborIndices += nbNeighbors[a];
+
+                    Particle& particle = _particles[index];
+                    particle.setDensity( cellDensities[a] / corrections[a] );
+                    particle.setVolume( particle.mass() / particle.density() );
+                    particle.setPressure( pressure( cellDensities[a] ) );
                 }
             }
         }
 
-        particle.setDensity( density / correction );
-        particle.setVolume( particle.mass() / particle.density() );
-        particle.setPressure( pressure( density ) );
+        _cellPartition.recordBusyTime( timer.nsecsElapsed() );
     }
+
+    Profiler::profiler().recordThreadTimes( Profiler::Densities, _cellPartition.busyTimes() );
 }
 
 void SPH::computeForces()
 {
+    ProfilerScope profilerScope( Profiler::Forces );
+
+    _viscosityWeights = 0;
+    _viscosityCorrections = 0;
+
+    if ( _isViscosityImplicit )
+    {
+        _viscosityWeights = FrameArena::frameArena().allocate<float*>( _particles.size() );
+        _viscosityCorrections = FrameArena::frameArena().allocate<float>( _particles.size() );
+    }
+
+    if ( _isKernelTabulated )
+        computeForces( _tabulatedKernels );
+    else
+    {
+        switch ( _kernelFamily )
+        {
+        case MullerKernelFamily : computeForces( _mullerKernels ); break;
+        case WendlandC2KernelFamily : computeForces( _wendlandC2Kernels ); break;
+        case WendlandC4KernelFamily : computeForces( _wendlandC4Kernels ); break;
+        case CubicSplineKernelFamily : computeForces( _cubicSplineKernels ); break;
+        default : break;
+        }
+    }
+}
+
+template <class Kernels>
+void SPH::computeForces( const Kernels& kernels )
+{
+    _tiles.packForces( _particles );
+
     // Compute gravity vector
     QVector3D gravity = localTransformation().inverted().mapVector( _gravity );
 
-    // For each particle
-#pragma omp parallel for schedule( guided )
-    for ( int i=0 ; i<_particles.size() ; ++i )
+    const unsigned int* indices = _tiles.indices();
+    const float* x = _tiles.positions( 0 );
+    const float* y = _tiles.positions( 1 );
+    const float* z = _tiles.positions( 2 );
+    const float* vx = _tiles.velocities( 0 );
+    const float* vy = _tiles.velocities( 1 );
+    const float* vz = _tiles.velocities( 2 );
+    const float* pressures = _tiles.pressures();
+    const float* volumes = _tiles.volumes();
+
+    // The work of a particle is its number of neighbors
+    int nbParticles = _particles.size();
+
+    if ( _isLoadBalanced )
     {
-        QVector3D pressureForce;
-        QVector3D viscosityForce;
-        QVector3D tensionForce;
-        float correction = 0;
+        _workCosts.resize( nbParticles );
 
-        Particle& particle = _particles[i];
-        const QVector<unsigned int>& neighborhood = _grid.neighborhood( particle.cellIndex() );
+        for ( int i=0 ; i<nbParticles ; ++i )
+            _workCosts[i] = _nbNeighbors[indices[i]];
 
-        // For each neighbor cell
-        for ( int j=0 ; j<neighborhood.size() ; ++j )
+        _particlePartition.balance( _workCosts.constData(), nbParticles );
+    }
+    else
+        _particlePartition.split( nbParticles );
+
+    // For each particle, cell by cell in the order of the tiles
+#pragma omp parallel
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+#pragma omp for schedule( guided ) nowait
+        for ( int range=0 ; range<_particlePartition.nbRanges() ; ++range )
         {
-            const QVector<unsigned int>& neighbors = _grid.cellParticles( neighborhood[j] );
+            unsigned int rangeEnd = _particlePartition.end( range );
 
-            // For each particle in a neighboring cell
-            for ( int k=0 ; k<neighbors.size() ; ++k )
+            for ( unsigned int i=_particlePartition.begin( range ) ; i<rangeEnd ; ++i )
             {
-                const Particle& neighbor = _particles[neighbors[k]];
-                QVector3D difference = particle.position() - neighbor.position();
-                float r2 = difference.lengthSquared();
+                QVector3D pressureForce;
+                QVector3D viscosityForce;
+                QVector3D tensionForce;
+                float correction = 0;
 
-                // If the neighboring particle is inside a sphere of radius 'h'
-                if ( r2 < _smoothingRadius2 )
+                unsigned int index = indices[i];
+                const unsigned int* neighborSlots = _neighborSlots[i];
+                float* viscosityWeights = 0;
+
+                if ( _viscosityWeights )
+                {
+                    viscosityWeights = FrameArena::threadArena().allocate<float>( _nbNeighbors[index] );
+                    _viscosityWeights[index] = viscosityWeights;
+                }
+
+                // For each particle inside a sphere of radius 'h' ( see computeDensities )
+                for ( unsigned int k=0 ; k<_nbNeighbors[index] ; ++k )
                 {
-                    float r = ::sqrt( r2 );
-                    float volume = neighbor.volume();
-                    float meanPressure = ( neighbor.pressure() + particle.pressure() ) * 0.5;
+                    unsigned int j = neighborSlots[k];
+                    QVector3D difference( x[i] - x[j], y[i] - y[j], z[i] - z[j] );
+                    float r2 = difference.x() * difference.x() + difference.y() * difference.y() + difference.z() * difference.z();
+                    float volume = volumes[j];
+                    float meanPressure = ( pressures[j] + pressures[i] ) * 0.5;
 
                     // Add forces contribution
-                    pressureForce -= difference * ( pressureKernel( r ) * meanPressure * volume );
-                    viscosityForce += ( neighbor.velocity() - particle.velocity() ) * ( viscosityKernel( r ) * volume );
+                    pressureForce -= difference * ( kernels.pressure( r2 ) * meanPressure * volume );
+                    float viscosityKernel = kernels.viscosity( r2 ) * volume;
+
+                    if ( viscosityWeights )
+                        viscosityWeights[k] = viscosityKernel;
+                    else
+                        viscosityForce += QVector3D( vx[j] - vx[i], vy[j] - vy[i], vz[j] - vz[i] ) * viscosityKernel;
 
-                    float kernelRR = densityKernel( r2 );
+                    float kernelRR = kernels.density( r2 );
                     tensionForce += difference * kernelRR; // * Mass_b / Mass_a, but in our case, this equals 1
                     correction += kernelRR * volume;
                 }
+
+                if ( viscosityWeights )
+                    _viscosityCorrections[index] = correction;
+
+                // Normalize results and apply uniform coefficients;
+                pressureForce *= _pressure / correction;
+                viscosityForce *= _viscosity / correction;
+                tensionForce *= _surfaceTension / correction;
+
+                // Compute the sum of all forces and convert it to an acceleration
+                Particle& particle = _particles[index];
+                particle.setAcceleration( ( viscosityForce - pressureForce - tensionForce ) / particle.density() + gravity );
             }
         }
 
-        // Normalize results and apply uniform coefficients;
-        pressureForce *= _pressure / correction;
-        viscosityForce *= _viscosity / correction;
-        tensionForce *= _surfaceTension / correction;
+        _particlePartition.recordBusyTime( timer.nsecsElapsed() );
+    }
+
+    Profiler::profiler().recordThreadTimes( Profiler::Forces, _particlePartition.busyTimes() );
+}
+
+// Implicit viscosity, for viscosities the explicit forces cannot reach without
+// tiny time steps. With mu_ij = viscosity * V_i * V_j * laplacian( r_ij ) and
+// c_i the normalization of the forces of particle i ( see computeForces ), the
+// explicit viscous forces are m_i c_i dv_i/dt = sum_j mu_ij ( v_j - v_i ), as
+// V_i = m_i / rho_i. Keeping c_i with the mass leaves the matrix symmetric and
+// gives the viscosity the same meaning with both solvers. The new velocities
+// solve
+//
+//     m_i c_i v_i - dt sum_j mu_ij ( v_j - v_i ) = m_i c_i ( v_i + dt a_i )
+//
+// dt and the velocities on the right being the ones of the kick of the
+// integrator ( see kickTime ). The matrix is symmetric positive definite, the
+// system is solved by a conjugate gradient with a Jacobi preconditioner. The
+// matrix is never built, see 'multiplyViscosity'. The viscous velocities go
+// back to moveParticles as accelerations.
+void SPH::solveViscosity( float deltaTime )
+{
+    ProfilerScope profilerScope( Profiler::Viscosity );
+
+    if ( deltaTime <= 0 )
+        return;
+
+    float kick = kickTime( deltaTime );
+
+    int nbParticles = _particles.size();
+    FrameArena& arena = FrameArena::frameArena();
+    float* masses = arena.allocate<float>( nbParticles );
+    float* diagonals = arena.allocate<float>( nbParticles );
+    QVector3D* velocities = arena.allocate<QVector3D>( nbParticles );
+    QVector3D* residuals = arena.allocate<QVector3D>( nbParticles );
+    QVector3D* preconditioned = arena.allocate<QVector3D>( nbParticles );
+    QVector3D* directions = arena.allocate<QVector3D>( nbParticles );
+    QVector3D* products = arena.allocate<QVector3D>( nbParticles );
+
+    // Starts from the velocities without viscosity, the right hand side
+    // being kept in 'products' for the tolerance
+#pragma omp parallel for schedule( guided )
+    for ( int i=0 ; i<nbParticles ; ++i )
+    {
+        const Particle& particle = _particles[i];
+        float scale = kick * _viscosity * particle.volume();
+        float mass = particle.mass() * _viscosityCorrections[i];
+        float diagonal = mass;
+
+        for ( unsigned int k=0 ; k<_nbNeighbors[i] ; ++k )
+            diagonal += scale * _viscosityWeights[i][k];
+
+        masses[i] = mass;
+        diagonals[i] = diagonal;
+        velocities[i] = kickStartVelocity( i ) + kick * particle.acceleration();
+        products[i] = velocities[i] * masses[i];
+    }
+
+    QVector3D tolerance = componentDot( products, products, nbParticles ) * ( viscosityTolerance * viscosityTolerance );
+    multiplyViscosity( velocities, diagonals, products, kick );
+
+#pragma omp parallel for schedule( static )
+    for ( int i=0 ; i<nbParticles ; ++i )
+    {
+        residuals[i] = velocities[i] * masses[i] - products[i];
+        preconditioned[i] = residuals[i] / diagonals[i];
+        directions[i] = preconditioned[i];
+    }
+
+    QVector3D residualsPreconditioned = componentDot( residuals, preconditioned, nbParticles );
+
+    for ( unsigned int iteration=0 ; iteration<maxViscosityIterations ; ++iteration )
+    {
+        QVector3D residualNorms = componentDot( residuals, residuals, nbParticles );
+
+        if ( residualNorms.x() <= tolerance.x() && residualNorms.y() <= tolerance.y() && residualNorms.z() <= tolerance.z() )
+            break;
+
+        multiplyViscosity( directions, diagonals, products, kick );
+        QVector3D alpha = componentRatio( residualsPreconditioned, componentDot( directions, products, nbParticles ) );
+
+#pragma omp parallel for schedule( static )
+        for ( int i=0 ; i<nbParticles ; ++i )
+        {
+            velocities[i] += alpha * directions[i];
+            residuals[i] -= alpha * products[i];
+            preconditioned[i] = residuals[i] / diagonals[i];
+        }
+
+        QVector3D nextResidualsPreconditioned = componentDot( residuals, preconditioned, nbParticles );
+        QVector3D beta = componentRatio( nextResidualsPreconditioned, residualsPreconditioned );
+        residualsPreconditioned = nextResidualsPreconditioned;
+
+#pragma omp parallel for schedule( static )
+        for ( int i=0 ; i<nbParticles ; ++i )
+            directions[i] = preconditioned[i] + beta * directions[i];
+    }
+
+#pragma omp parallel for schedule( static )
+    for ( int i=0 ; i<nbParticles ; ++i )
+    {
+        Particle& particle = _particles[i];
+        particle.setAcceleration( ( velocities[i] - kickStartVelocity( i ) ) / kick );
+    }
+}
+
+// Product of the matrix of 'solveViscosity' with a vector, over the neighbor
+// lists. The neighbor relation being symmetric, so is the matrix.
+void SPH::multiplyViscosity( const QVector3D* vector, const float* diagonals, QVector3D* result, float deltaTime ) const
+{
+#pragma omp parallel for schedule( guided )
+    for ( int i=0 ; i<_particles.size() ; ++i )
+    {
+        const Particle& particle = _particles[i];
+        const unsigned int* neighbors = _neighbors[i];
+        const float* weights = _viscosityWeights[i];
+        QVector3D diffusion;
+
+        for ( unsigned int k=0 ; k<_nbNeighbors[i] ; ++k )
+            diffusion += vector[neighbors[k]] * weights[k];
 
-        // Compute the sum of all forces and convert it to an acceleration
-        particle.setAcceleration( ( viscosityForce - pressureForce - tensionForce ) / particle.density() + gravity );
+        result[i] = vector[i] * diagonals[i] - diffusion * ( deltaTime * _viscosity * particle.volume() );
     }
 }
 
+// Leapfrog in kick-drift-kick form, with one force evaluation per step:
+//
+//     v( n + 1/2 ) = v( n ) + dt/2 a( n )
+//     x( n + 1 )   = x( n ) + dt v( n + 1/2 )
+//     v( n + 1 )   = v( n + 1/2 ) + dt/2 a( n + 1 )
+//
+// The last kick needs the accelerations of the next step, so the particles
+// end a step with the velocities of its middle. Before the next forces, which
+// depend on the velocities through the viscosity, their velocities are
+// brought to the start of the step with the accelerations they still have
+// from the last step, the middle ones being kept for 'moveParticles', which
+// kicks them by the two halves with the new accelerations.
+void SPH::synchronizeVelocities()
+{
+    _halfStepVelocities.resize( _particles.size() );
+
+#pragma omp parallel for schedule( static )
+    for ( int i=0 ; i<_particles.size() ; ++i )
+    {
+        Particle& particle = _particles[i];
+        _halfStepVelocities[i] = particle.velocity();
+        particle.setVelocity( particle.velocity() + _pendingHalfDeltaTime * particle.acceleration() );
+    }
+}
+
+// The new velocities are v0 + t a: from the start of the step over dt with
+// the semi-implicit Euler, from the middle of the last step over the two half
+// steps around the new accelerations with the leapfrog
+const QVector3D& SPH::kickStartVelocity( unsigned int index ) const
+{
+    return ( _integrator == LeapfrogIntegrator ) ? _halfStepVelocities[index] : _particles[index].velocity();
+}
+
+float SPH::kickTime( float deltaTime ) const
+{
+    return ( _integrator == LeapfrogIntegrator ) ? _pendingHalfDeltaTime + 0.5f * deltaTime : deltaTime;
+}
+
 void SPH::moveParticles( float deltaTime )
 {
+    ProfilerScope profilerScope( Profiler::Move );
 
     ////////////////////////////////////////////////////
     // IFT3355 - À compléter
@@ -278,68 +942,104 @@ void SPH::moveParticles( float deltaTime )
     ////////////////////////////////////////////////////
 
     float bias = 0.0005;
+    _movingParticles.resize(0);
+
     for (int i = 0; i < _particles.size(); i++)
     {
         // Calcul de la nouvelle velocite
-        // Methode d'Euler semi-explicite
-        QVector3D velocity = _particles[i].velocity() + deltaTime * _particles[i].acceleration();
+        // Methode d'Euler semi-explicite, ou les deux demi-impulsions du saut de
+        // grenouille autour des nouvelles accelerations ( voir synchronizeVelocities )
+        QVector3D velocity = kickStartVelocity(i) + kickTime(deltaTime) * _particles[i].acceleration();
 
         // Calcul de la nouvelle position, du mouvement et initialisation du mouvement restant
         QVector3D position = _particles[i].position();
         QVector3D newPosition = _particles[i].position() + deltaTime * velocity;
         QVector3D movement = newPosition - position;
-        QVector3D movementLeft = movement;
 
-        //Initialisation de l'intersection
-        Intersection intersection;
+        // Loin des parois, le mouvement ne peut pas les atteindre et le lancer
+        // de rayon est inutile
+        float distance = _container.distanceToBoundary( position );
+
+        if (distance > 0 && movement.lengthSquared() < distance * distance)
+        {
+            _particles[i].setPosition(newPosition);
+            _particles[i].setVelocity(velocity);
+        }
+        else
+        {
+            MovingParticle movingParticle = { (unsigned int)i, position, newPosition, movement, movement, velocity };
+            _movingParticles.append(movingParticle);
+        }
+    }
 
-        // Boucle tant qu'il y a des intersections
-        while (true)
+    // Les particules pres des parois sont deplacees ensemble: a chaque tour, un
+    // seul lancer de rayons par paquet pour toutes celles qui bougent encore
+    while (!_movingParticles.isEmpty())
+    {
+        _collisionRays.clear();
+        for (int k = 0; k < _movingParticles.size(); k++)
         {
-            QVector3D direction = movement.normalized();
-            Ray ray = Ray(position, direction);
+            const MovingParticle& movingParticle = _movingParticles[k];
+            _collisionRays.append(Ray(movingParticle.position, movingParticle.movement.normalized()));
+        }
+
+        _container.intersect(_collisionRays, _collisionIntersections);
+
+        int nbStillMoving = 0;
+        for (int k = 0; k < _movingParticles.size(); k++)
+        {
+            MovingParticle movingParticle = _movingParticles[k];
+            QVector3D direction = _collisionRays.ray(k).direction();
 
             // Si la particule intersecte le container avant d'avoir atteint sa position finale
-            if (_container.intersect(ray, intersection) &&
-                    (intersection.rayParameterT() * direction).length() < movementLeft.length())
+            if (_collisionIntersections.isHit(k) &&
+                    (_collisionIntersections.rayParameterTs()[k] * direction).length() < movingParticle.movementLeft.length())
             {
-
+                Intersection intersection = _collisionIntersections.intersection(k);
                 QVector3D normal = intersection.normal();
 
-                position = intersection.position();
+                QVector3D position = intersection.position();
 
                 // Calcul du mouvement restant que la collision a empechee
-                movementLeft = newPosition - position;
+                QVector3D& movementLeft = movingParticle.movementLeft;
+                movementLeft = movingParticle.newPosition - position;
 
                 //Calcul du nouveau mouvement par une projection normalisee a laquelle on multiplie la longueur
                 //du mouvement restant, (collision non elastique)
-                movement = movementLeft - QVector3D::dotProduct(movementLeft, normal) * normal;
+                movingParticle.movement = movementLeft - QVector3D::dotProduct(movementLeft, normal) * normal;
 
                 // Positionnement de la particule juste un peu avant l'intersection rencontree, pour que
                 // la particule ne soit pas directement sur la surface du container lors du prochain trace
-                position = position - normal*bias;
+                movingParticle.position = position - normal*bias;
 
                 //Calcul de la nouvelle position
-                newPosition = position + movement;
+                movingParticle.newPosition = movingParticle.position + movingParticle.movement;
 
                 // Correction de la velocite
+                QVector3D& velocity = movingParticle.velocity;
                 velocity = velocity - QVector3D::dotProduct(velocity, normal) * normal;
+
+                _movingParticles[nbStillMoving++] = movingParticle;
             }
 
             // Si la particule a atteint sa position finale (ie plus d'intersection)
             else
             {
-
-                position += movement;
-                _particles[i].setPosition(position);
-                _particles[i].setVelocity(velocity);
-                break;
+                _particles[movingParticle.index].setPosition(movingParticle.position + movingParticle.movement);
+                _particles[movingParticle.index].setVelocity(movingParticle.velocity);
             }
         }
 
-        // Mise a jour de la cellule dans la grille
+        _movingParticles.resize(nbStillMoving);
+    }
+
+    _pendingHalfDeltaTime = (_integrator == LeapfrogIntegrator) ? 0.5f * deltaTime : 0;
+
+    // Mise a jour de la cellule dans la grille
+    for (int i = 0; i < _particles.size(); i++)
+    {
         unsigned int oldCellIndex = _particles[i].cellIndex();
-        unsigned int newCellIndex = _grid.cellIndex(position);
+        unsigned int newCellIndex = _grid.cellIndex(_particles[i].position());
         if (oldCellIndex != newCellIndex)
         {
             _particles[i].setCellIndex(newCellIndex);
@@ -347,10 +1047,245 @@ void SPH::moveParticles( float deltaTime )
             _grid.addParticle(newCellIndex, i);
         }
     }
+}
+
+void SPH::recordMemoryUsage()
+{
+    MemoryFootprint& footprint = MemoryFootprint::memoryFootprint();
+    footprint.setNbParticles( _particles.size() );
+
+    footprint.record( MemoryFootprint::Particles, _particles.capacity() * sizeof( Particle ) +
+                                                  _halfStepVelocities.capacity() * sizeof( QVector3D ) +
+                                                  _movingParticles.capacity() * sizeof( MovingParticle ) );
+    footprint.record( MemoryFootprint::GridNeighborhoods, _grid.neighborhoodMemoryUsage() );
+    footprint.record( MemoryFootprint::GridCells, _grid.cellMemoryUsage() );
+    footprint.record( MemoryFootprint::Tiles, _tiles.memoryUsage() + _workCosts.capacity() * sizeof( unsigned int ) );
+    footprint.record( MemoryFootprint::FrameArenas, FrameArena::totalCapacity() );
+
+    // The surface thread only reads the snapshot, which is only written by
+    // 'takeSurfaceSnapshot'. Until the first snapshot, its cells are shared
+    // with the grid and not counted twice.
+    footprint.record( MemoryFootprint::SurfaceSnapshot, _surfaceParticles.capacity() * sizeof( Particle ) +
+                                                        _surfaceGrid.cellMemoryUsage( &_grid ) );
+}
+
+void SPH::recordSurfaceMemoryUsage()
+{
+    MemoryFootprint& footprint = MemoryFootprint::memoryFootprint();
+    size_t kernelBytes = _surfaceKernels.capacity() * sizeof( AnisotropicKernel ) +
+                         _packedCellStarts.capacity() * sizeof( unsigned int ) +
+                         _packedMasses.capacity() * sizeof( float ) +
+                         _surfacePositions.capacity() * sizeof( QVector3D );
 
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        kernelBytes += _packedCenters[i].capacity() * sizeof( float );
 
+    for ( unsigned int i=0 ; i<6 ; ++i )
+        kernelBytes += _packedTransformations[i].capacity() * sizeof( float );
+
+    footprint.record( MemoryFootprint::SurfaceKernels, kernelBytes );
+    footprint.record( MemoryFootprint::SurfaceLattice, _marchingTetrahedra.latticeMemoryUsage() );
+    footprint.record( MemoryFootprint::SurfaceMesh, _marchingTetrahedra.meshMemoryUsage() );
 }
 
+void SPH::recordLiveMetrics( float deltaTime )
+{
+    const Particles& particles = _particles;
+    float maxSpeed2 = 0;
+    float maxDensityError = 0;
+
+    // The pressure is the relative error of the uncorrected density
+    for ( int i=0 ; i<particles.size() ; ++i )
+    {
+        maxSpeed2 = std::max( maxSpeed2, particles[i].velocity().lengthSquared() );
+        maxDensityError = std::max( maxDensityError, std::fabs( particles[i].pressure() ) );
+    }
+
+    LiveMetrics::liveMetrics().recordStep( particles.size(), deltaTime, std::sqrt( maxSpeed2 ), maxDensityError );
+}
+
+
+void SPH::takeSurfaceSnapshot()
+{
+    // Copied into the buffers of the snapshot, which keep their capacity. A
+    // shared copy would be detached by the first parallel loop writing to the
+    // particles, from every thread at once.
+    _surfaceParticles.resize( _particles.size() );
+    std::copy( _particles.constBegin(), _particles.constEnd(), _surfaceParticles.begin() );
+    _surfaceGrid.copyCells( _grid );
+    _nbStepsSinceSurface = 0;
+}
+
+void SPH::extractSurface( FrameArena& arena )
+{
+    ProfilerScope profilerScope( Profiler::Surface );
+
+    computeSurfaceKernels();
+    invalidateMovedSurface();
+    _marchingTetrahedra.update( *this, arena );
+    recordSurfaceMemoryUsage();
+}
+
+void SPH::computeSurfaceKernels()
+{
+    const QVector<Particle>& particles = _surfaceParticles;
+    int nbThreads = ( QThread::currentThread() == &_surfaceThread ) ? surfaceThreadTeam : WorkPartition::nbThreads();
+
+    // For each particle
+#pragma omp parallel for schedule( guided ) num_threads( nbThreads )
+    for ( int i=0 ; i<particles.size() ; ++i )
+    {
+        const Particle& particle = particles[i];
+        AnisotropicKernel& kernel = _surfaceKernels[i];
+
+        if ( !_anisotropicSurface )
+        {
+            kernel.setIsotropic( particle.position() );
+            continue;
+        }
+
+        const QVector<unsigned int>& neighborhood = _surfaceGrid.neighborhood( particle.cellIndex() );
+        QVector3D weightedMean;
+        float totalWeight = 0;
+        unsigned int nbNeighbors = 0;
+
+        // Weighted mean of the neighbor positions
+        for ( int j=0 ; j<neighborhood.size() ; ++j )
+        {
+            const QVector<unsigned int>& neighbors = _surfaceGrid.cellParticles( neighborhood[j] );
+
+            for ( int k=0 ; k<neighbors.size() ; ++k )
+            {
+                const Particle& neighbor = particles[neighbors[k]];
+                float r2 = ( particle.position() - neighbor.position() ).lengthSquared();
+
+                if ( r2 < _smoothingRadius2 )
+                {
+                    float ratio = ::sqrt( r2 ) / _smoothingRadius;
+                    float weight = 1 - ratio * ratio * ratio;
+                    weightedMean += neighbor.position() * weight;
+                    totalWeight += weight;
+                    ++nbNeighbors;
+                }
+            }
+        }
+
+        // Not enough neighbors for a meaningful distribution ( splashes )
+        if ( nbNeighbors < minAnisotropicNeighbors )
+        {
+            kernel.setIsotropic( particle.position() );
+            continue;
+        }
+
+        weightedMean /= totalWeight;
+
+        // Weighted covariance of the neighbor positions
+        float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+
+        for ( int j=0 ; j<neighborhood.size() ; ++j )
+        {
+            const QVector<unsigned int>& neighbors = _surfaceGrid.cellParticles( neighborhood[j] );
+
+            for ( int k=0 ; k<neighbors.size() ; ++k )
+            {
+                const Particle& neighbor = particles[neighbors[k]];
+                float r2 = ( particle.position() - neighbor.position() ).lengthSquared();
+
+                if ( r2 < _smoothingRadius2 )
+                {
+                    float ratio = ::sqrt( r2 ) / _smoothingRadius;
+                    float weight = ( 1 - ratio * ratio * ratio ) / totalWeight;
+                    QVector3D d = neighbor.position() - weightedMean;
+
+                    covariance[0] += weight * d.x() * d.x();
+                    covariance[1] += weight * d.y() * d.y();
+                    covariance[2] += weight * d.z() * d.z();
+                    covariance[3] += weight * d.x() * d.y();
+                    covariance[4] += weight * d.x() * d.z();
+                    covariance[5] += weight * d.y() * d.z();
+                }
+            }
+        }
+
+        // Laplacian smoothing of the kernel center
+        QVector3D center = particle.position() * ( 1 - centerSmoothing ) + weightedMean * centerSmoothing;
+
+        kernel.set( particle.position(), center, covariance, _smoothingRadius );
+    }
+
+    packSurfaceKernels();
+}
+
+void SPH::packSurfaceKernels()
+{
+    const QVector<Particle>& particles = _surfaceParticles;
+    unsigned int nbCells = _surfaceGrid.nbCells();
+    unsigned int nbParticles = particles.size();
+
+    _packedCellStarts.resize( nbCells + 1 );
+    _packedMasses.resize( nbParticles );
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+        _packedCenters[i].resize( nbParticles );
+
+    for ( unsigned int i=0 ; i<6 ; ++i )
+        _packedTransformations[i].resize( nbParticles );
+
+    unsigned int current = 0;
+
+    for ( unsigned int cell=0 ; cell<nbCells ; ++cell )
+    {
+        const QVector<unsigned int>& cellParticles = _surfaceGrid.cellParticles( cell );
+        _packedCellStarts[cell] = current;
+
+        for ( int k=0 ; k<cellParticles.size() ; ++k, ++current )
+        {
+            const AnisotropicKernel& kernel = _surfaceKernels[cellParticles[k]];
+            const float* transformation = kernel.transformation();
+
+            _packedCenters[0][current] = kernel.center().x();
+            _packedCenters[1][current] = kernel.center().y();
+            _packedCenters[2][current] = kernel.center().z();
+
+            for ( unsigned int i=0 ; i<6 ; ++i )
+                _packedTransformations[i][current] = transformation[i];
+
+            _packedMasses[current] = particles[cellParticles[k]].mass() * kernel.determinant();
+        }
+    }
+
+    _packedCellStarts[nbCells] = current;
+}
+
+void SPH::invalidateMovedSurface()
+{
+    // A particle reaches the field up to the smoothing radius around it. With
+    // anisotropic kernels it also reshapes the kernels of its neighbors.
+    float reach = _anisotropicSurface ? 2 * _smoothingRadius : _smoothingRadius;
+    float tolerance = surfaceTolerance * _smoothingRadius;
+    QVector3D margin( reach, reach, reach );
+    const QVector<Particle>& particles = _surfaceParticles;
+
+    for ( int i=0 ; i<particles.size() ; ++i )
+    {
+        const QVector3D& position = particles[i].position();
+        QVector3D& surfacePosition = _surfacePositions[i];
+
+        if ( ( position - surfacePosition ).lengthSquared() <= tolerance * tolerance )
+            continue;
+
+        // Both where it was and where it is now
+        QVector3D minimum( std::min( position.x(), surfacePosition.x() ),
+                           std::min( position.y(), surfacePosition.y() ),
+                           std::min( position.z(), surfacePosition.z() ) );
+        QVector3D maximum( std::max( position.x(), surfacePosition.x() ),
+                           std::max( position.y(), surfacePosition.y() ),
+                           std::max( position.z(), surfacePosition.z() ) );
+
+        _marchingTetrahedra.invalidate( BoundingBox( minimum - margin, maximum + margin ) );
+        surfacePosition = position;
+    }
+}
 
 void SPH::surfaceInfo( const QVector3D& position, float& value, QVector3D& normal )
 {
@@ -368,49 +1303,83 @@ void SPH::surfaceInfo( const QVector3D& position, float& value, QVector3D& norma
     // particules voisines.
     ////////////////////////////////////////////////////
 
-    //Initialisation des variables de densite
+    const unsigned int* cellStarts = _packedCellStarts.constData();
+    const float* centerX = _packedCenters[0].constData();
+    const float* centerY = _packedCenters[1].constData();
+    const float* centerZ = _packedCenters[2].constData();
+    const float* gxx = _packedTransformations[0].constData();
+    const float* gyy = _packedTransformations[1].constData();
+    const float* gzz = _packedTransformations[2].constData();
+    const float* gxy = _packedTransformations[3].constData();
+    const float* gxz = _packedTransformations[4].constData();
+    const float* gyz = _packedTransformations[5].constData();
+    const float* masses = _packedMasses.constData();
+
+    float x = position.x();
+    float y = position.y();
+    float z = position.z();
+
+    // Sum of m * diff^3 for the value and of m * diff^2 * G^T * G * ( x - center )
+    // for the gradient, with diff = h^2 - r^2 evaluated once per particle
     float density = 0;
-    float densityKernelGradientX = 0;
-    float densityKernelGradientY = 0;
-    float densityKernelGradientZ = 0;
+    float gradientX = 0;
+    float gradientY = 0;
+    float gradientZ = 0;
 
-    //Get neighborhood
-    const QVector<unsigned int>& neighborhood = _grid.neighborhood(_grid.cellIndex(position));
+    const QVector<unsigned int>& neighborhood = _surfaceGrid.neighborhood( _surfaceGrid.cellIndex( position ) );
 
     // For each neighbor cell
     for ( int j=0 ; j<neighborhood.size() ; ++j )
     {
-        //Get particles of the cell
-        const QVector<unsigned int>& neighbors = _grid.cellParticles( neighborhood[j] );
+        unsigned int end = cellStarts[neighborhood[j]+1];
 
-        // For each particle in a neighboring cell
-        for ( int k=0 ; k<neighbors.size() ; ++k )
+        // The kernels of a later cell are loaded while this one is processed
+        if ( j + cellPrefetchDistance < neighborhood.size() )
         {
-            const Particle& neighbor = _particles[neighbors[k]];
-            QVector3D difference = position - neighbor.position();
-            float r2 = difference.lengthSquared();
+            unsigned int later = cellStarts[neighborhood[j + cellPrefetchDistance]];
+            prefetch( centerX + later );
+            prefetch( centerY + later );
+            prefetch( centerZ + later );
+            prefetch( gxx + later );
+            prefetch( gyy + later );
+            prefetch( gzz + later );
+            prefetch( gxy + later );
+            prefetch( gxz + later );
+            prefetch( gyz + later );
+            prefetch( masses + later );
+        }
 
-            // If the neighboring particle is inside a sphere of radius 'h'
+        // For each particle of the cell
+        for ( unsigned int k=cellStarts[neighborhood[j]] ; k<end ; ++k )
+        {
+            // Distance in the space of the kernel ( G * ( x - center ) )
+            float dx = x - centerX[k];
+            float dy = y - centerY[k];
+            float dz = z - centerZ[k];
+            float ex = gxx[k] * dx + gxy[k] * dy + gxz[k] * dz;
+            float ey = gxy[k] * dx + gyy[k] * dy + gyz[k] * dz;
+            float ez = gxz[k] * dx + gyz[k] * dy + gzz[k] * dz;
+            float r2 = ex * ex + ey * ey + ez * ez;
+
+            // If the position is inside the support of the kernel
             if ( r2 < _smoothingRadius2 )
             {
-                // Add density contribution
-                density += densityKernel( r2 ) * neighbor.mass();
-
-                // Calcul des composantes du gradient de f
-                densityKernelGradientX +=(2*(position.x() - neighbor.position().x()))* densitykernelGradient(r2)*neighbor.mass();
-                densityKernelGradientY +=(2*(position.y() - neighbor.position().y()))* densitykernelGradient(r2)*neighbor.mass();
-                densityKernelGradientZ +=(2*(position.z() - neighbor.position().z()))*densitykernelGradient(r2)*neighbor.mass();
+                float diff = _smoothingRadius2 - r2;
+                float weight = masses[k] * diff * diff;
 
+                density += weight * diff;
+                gradientX += weight * ( gxx[k] * ex + gxy[k] * ey + gxz[k] * ez );
+                gradientY += weight * ( gxy[k] * ex + gyy[k] * ey + gyz[k] * ez );
+                gradientZ += weight * ( gxz[k] * ex + gyz[k] * ey + gzz[k] * ez );
             }
         }
     }
 
-    normal.setX(densityKernelGradientX/_restDensity); //Etant donne que cest une derivee on ne rajoute pas le "-(1-a)"
-    normal.setY(densityKernelGradientY/_restDensity);
-    normal.setZ(densityKernelGradientZ/_restDensity);
-
+    // The density gradient is -6 * coeffPoly6 times the sum. The normal points
+    // against it, and only its direction is needed.
+    normal = QVector3D( gradientX, gradientY, gradientZ );
     normal.normalize();
-    normal = -normal;
+
     float a = 0.3;
-    value = density / _restDensity - (1 - a);
+    value = _coeffPoly6 * density / _restDensity - (1 - a);
 }
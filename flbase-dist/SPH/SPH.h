@@ -1,15 +1,25 @@
 #ifndef SPH_H
 #define SPH_H
 
+#include "Geometry/AdaptiveMarchingTetrahedra.h"
 #include "Geometry/Geometry.h"
+#include "Geometry/IntersectionBatch.h"
 #include "Geometry/ImplicitSurface.h"
 #include "Geometry/MarchingTetrahedra.h"
+#include "Geometry/RayBatch.h"
+#include "SPH/AnisotropicKernel.h"
+#include "SPH/Kernels.h"
 #include "SPH/Particles.h"
+#include "SPH/ParticleTiles.h"
 #include "SPH/Grid.h"
+#include "SPH/SurfaceThread.h"
+#include "SPH/TabulatedKernels.h"
+#include "SPH/WorkPartition.h"
+#include "ScreenSpaceFluid.h"
 #include "TimeState.h"
 
 /* SPH is responsible for animating the particles and rendering the fluid given a
- * rendering method ( particles or marhcing tetrahedra ).
+ * rendering method ( particles, marhcing tetrahedra or screen space ).
  *
  * See M. Müller, D. Charypar et M. Gross. 2003
  *     Particle-based fluid simulation for interactive applications.
@@ -17,6 +27,8 @@
 
 class SPH : public AbstractObject, public ImplicitSurface
 {
+    friend class SurfaceThread;
+
 public:
     SPH( AbstractObject* parent, const Geometry& container, float smoothingRadius, float viscosity, float pressure, float surfaceTension,
          unsigned int nbCellX, unsigned int nbCellY, unsigned int nbCellZ, unsigned int nbCubeX,
@@ -24,32 +36,96 @@ public:
          float totalVolume, float maxDTime, const QVector3D& gravity );
     virtual ~SPH();
 
+    enum RenderMode { RenderParticles, RenderImplicitSurface, RenderScreenSpace };
+    enum KernelFamily { MullerKernelFamily, WendlandC2KernelFamily, WendlandC4KernelFamily, CubicSplineKernelFamily, NbKernelFamilies };
+    enum Integrator { SemiImplicitEulerIntegrator, LeapfrogIntegrator, NbIntegrators };
+
     virtual void animate( const TimeState& timeState );
     virtual void render( GLShader& shader );
 
     void changeRenderMode();
+    void setRenderMode( RenderMode renderMode );
+    void changeSurfaceKernel();
+    void changeSurfaceExtraction();
+    void changeSurfaceThreading();
+    void setSurfaceThreaded( bool threadedSurface );
+    void setSurfaceInterval( unsigned int nbSteps );
     void changeMaterial();
+    void changeKernelFamily();
+    void setKernelFamily( KernelFamily kernelFamily );
+    KernelFamily kernelFamily() const;
+    void changeKernelTabulation();
+    void setKernelTabulated( bool isKernelTabulated );
+    void setMaxDeltaTime( float maxDeltaTime );
+    float maxDeltaTime() const;
+    void changeIntegrator();
+    void setIntegrator( Integrator integrator );
+    Integrator integrator() const;
+    void changeViscositySolver();
+    void setViscosityImplicit( bool isViscosityImplicit );
+    void changeLoadBalancing();
+    void setLoadBalanced( bool isLoadBalanced );
+
+    // For measurements, the neighbor pairs are only known during 'animate'
+    const Particles& particles() const;
+    quint64 nbNeighborPairs() const;
+    float smoothingRadius() const;
+
+    static const char* kernelFamilyName( KernelFamily kernelFamily );
+    static const char* integratorName( Integrator integrator );
     void resetVelocities();
 
 private:
+    // A particle whose movement may cross the container, moved by 'moveParticles'
+    // with the others near the walls through batched ray casts
+    struct MovingParticle
+    {
+        unsigned int index;
+        QVector3D position;
+        QVector3D newPosition;
+        QVector3D movement;
+        QVector3D movementLeft;
+        QVector3D velocity;
+    };
+
 	// Pre-computations
     BoundingBox inflatedContainerBoundingBox() const;
     void initializeCoefficients();
     void initializeParticles( float totalVolume );
 
-	// Kernels and pressure fonction
+	// Kernels of the surface and pressure fonction
     float densityKernel( float r2 ) const;
     float densitykernelGradient( float r2 ) const;
-    float pressureKernel( float r ) const;
-    float viscosityKernel( float r ) const;
     float pressure( float density ) const;
+    void tabulateKernels();
 
-	// Animation steps
+	// Animation steps. The density and force loops are compiled for each
+	// kernel family ( see Kernels.h ).
     void computeDensities();
     void computeForces();
+    template <class Kernels> void computeDensities( const Kernels& kernels );
+    template <class Kernels> void computeForces( const Kernels& kernels );
+    void solveViscosity( float deltaTime );
+    void multiplyViscosity( const QVector3D* vector, const float* diagonals, QVector3D* result, float deltaTime ) const;
+    void synchronizeVelocities();
+    const QVector3D& kickStartVelocity( unsigned int index ) const;
+    float kickTime( float deltaTime ) const;
     void moveParticles( float deltaTime );
 
-    // Marching tetrahedra rendering
+    // Memory footprint ( see MemoryFootprint ), of the simulation after a
+    // step and of the surface after its extraction, on their threads, and
+    // the state of the step for the live metrics ( see LiveMetrics )
+    void recordMemoryUsage();
+    void recordSurfaceMemoryUsage();
+    void recordLiveMetrics( float deltaTime );
+
+    // Marching tetrahedra rendering. Except for 'takeSurfaceSnapshot', these
+    // only read the snapshot and may run on the surface thread.
+    void takeSurfaceSnapshot();
+    void extractSurface( FrameArena& arena );
+    void computeSurfaceKernels();
+    void packSurfaceKernels();
+    void invalidateMovedSurface();
     virtual void surfaceInfo( const QVector3D& position, float& value, QVector3D& normal );
 
 private:
@@ -57,9 +133,14 @@ private:
 
 	// Pre-computations
     float _coeffPoly6;
-    float _coeffSpiky;
-    float _coeffVisc;
     float _restDensity;
+    MullerKernels _mullerKernels;
+    WendlandC2Kernels _wendlandC2Kernels;
+    WendlandC4Kernels _wendlandC4Kernels;
+    CubicSplineKernels _cubicSplineKernels;
+    TabulatedKernels _tabulatedKernels;
+    KernelFamily _kernelFamily;
+    bool _isKernelTabulated;
 
 	// Animation global properties
     float _smoothingRadius;
@@ -73,12 +154,71 @@ private:
 	// Particles and cells
     Particles _particles;
     Grid _grid;
+    ParticleTiles _tiles;
+
+    // Neighbor lists found by computeDensities and reused by computeForces.
+    // They live in the frame arenas and are only valid during 'animate'.
+    const unsigned int** _neighbors;
+    unsigned int* _nbNeighbors;
+
+    // The same lists as positions in the tiles, by position in the tiles
+    const unsigned int** _neighborSlots;
+
+    // With the implicit viscosity, computeForces keeps the viscosity kernel
+    // times the neighbor volume of each neighbor for 'solveViscosity', and
+    // the normalization of the forces of each particle
+    bool _isViscosityImplicit;
+    float** _viscosityWeights;
+    float* _viscosityCorrections;
+
+    // The cells of computeDensities and the particles of computeForces split
+    // in ranges of about the same cost, or one item per range without the
+    // load balancing
+    bool _isLoadBalanced;
+    WorkPartition _cellPartition;
+    WorkPartition _particlePartition;
+    QVector<unsigned int> _workCosts;
+
+    // With the leapfrog integrator, the particles keep the velocities of the
+    // middle of the last step, and the half kick that brings them to its end
+    // is given at the next step ( see synchronizeVelocities )
+    Integrator _integrator;
+    float _pendingHalfDeltaTime;
+    QVector<QVector3D> _halfStepVelocities;
+
+    // Reused by 'moveParticles' from one step to the next
+    QVector<MovingParticle> _movingParticles;
+    RayBatch _collisionRays;
+    IntersectionBatch _collisionIntersections;
+
     MarchingTetrahedra _marchingTetrahedra;
+    AdaptiveMarchingTetrahedra _adaptiveMarchingTetrahedra;
 
     // Rendering
-    enum RenderMode { RenderParticles, RenderImplicitSurface };
     RenderMode _renderMode;
+    bool _anisotropicSurface;
+    bool _adaptiveSurface;
+    QVector<AnisotropicKernel> _surfaceKernels;
+
+    // The surface kernels sorted by cell, as a structure of arrays, so that
+    // 'surfaceInfo' reads each cell as contiguous runs of floats
+    QVector<unsigned int> _packedCellStarts;
+    QVector<float> _packedCenters[3];
+    QVector<float> _packedTransformations[6];
+    QVector<float> _packedMasses; // Mass * det(G)
+    QVector<QVector3D> _surfacePositions; // Positions when the surface around was last rebuilt
     Material _material;
+    ScreenSpaceFluid _screenSpaceFluid;
+
+    // Snapshot of the simulation used by the surface, so the simulation can go
+    // on while the surface thread extracts it. The thread must stay last so it
+    // is stopped before anything it uses is destroyed.
+    QVector<Particle> _surfaceParticles;
+    Grid _surfaceGrid;
+    bool _threadedSurface;
+    unsigned int _surfaceInterval;
+    unsigned int _nbStepsSinceSurface;
+    SurfaceThread _surfaceThread;
 };
 
 #endif //SPH_H
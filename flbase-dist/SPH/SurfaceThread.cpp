@@ -0,0 +1,68 @@
+#include "SurfaceThread.h"
+#include "SPH/SPH.h"
+#include <QMutexLocker>
+
+SurfaceThread::SurfaceThread( SPH& sph )
+    : _sph( sph )
+    , _isBusy( false )
+    , _isStopping( false )
+{
+}
+
+SurfaceThread::~SurfaceThread()
+{
+    {
+        QMutexLocker locker( &_mutex );
+        _isStopping = true;
+        _requestCondition.wakeAll();
+    }
+
+    wait();
+}
+
+void SurfaceThread::request()
+{
+    if ( !isRunning() )
+        start();
+
+    QMutexLocker locker( &_mutex );
+    _isBusy = true;
+    _requestCondition.wakeAll();
+}
+
+bool SurfaceThread::isBusy()
+{
+    QMutexLocker locker( &_mutex );
+    return _isBusy;
+}
+
+void SurfaceThread::waitUntilIdle()
+{
+    QMutexLocker locker( &_mutex );
+
+    while ( _isBusy )
+        _idleCondition.wait( &_mutex );
+}
+
+void SurfaceThread::run()
+{
+    QMutexLocker locker( &_mutex );
+
+    while ( true )
+    {
+        while ( !_isBusy && !_isStopping )
+            _requestCondition.wait( &_mutex );
+
+        if ( _isStopping )
+            return;
+
+        // The SPH does not touch the snapshot while the thread is busy
+        locker.unlock();
+        _arena.reset();
+        _sph.extractSurface( _arena );
+        locker.relock();
+
+        _isBusy = false;
+        _idleCondition.wakeAll();
+    }
+}
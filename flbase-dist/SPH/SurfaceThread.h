@@ -0,0 +1,41 @@
+#ifndef SURFACETHREAD_H
+#define SURFACETHREAD_H
+
+#include "FrameArena.h"
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+class SPH;
+
+/* Extracts the surface of a SPH on its own thread, so the marching tetrahedra
+ * do not slow the simulation down. Each request extracts the surface of the
+ * last particle snapshot taken by the SPH. The thread has its own arena for
+ * the transient buffers, reset before each extraction.
+ */
+
+class SurfaceThread : public QThread
+{
+public:
+    SurfaceThread( SPH& sph );
+    virtual ~SurfaceThread();
+
+    void request();
+    bool isBusy();
+    void waitUntilIdle();
+
+protected:
+    virtual void run();
+
+private:
+    SPH& _sph;
+    FrameArena _arena;
+
+    QMutex _mutex;
+    QWaitCondition _requestCondition;
+    QWaitCondition _idleCondition;
+    bool _isBusy;
+    bool _isStopping;
+};
+
+#endif // SURFACETHREAD_H
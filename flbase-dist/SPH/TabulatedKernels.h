@@ -0,0 +1,77 @@
+#ifndef TABULATEDKERNELS_H
+#define TABULATEDKERNELS_H
+
+#include <QVector>
+
+/* A kernel family ( see Kernels.h ) sampled in r2 over [0, h^2] and read back
+ * with a linear interpolation, so that no square root is needed by the force
+ * loop whatever the family, and the loops are compiled only once for all the
+ * tabulated families. The three kernels of a sample are interleaved:
+ * the force loop reads them from the same cache line and the index, computed
+ * once per pair, is shared by the three lookups once inlined.
+ *
+ * The kernels that are singular at r = 0, like spiky's gradient divided by r,
+ * are underestimated in the first sample interval ( r < h / 64 with the default
+ * size ), which pressure keeps almost empty.
+ */
+
+class TabulatedKernels
+{
+public:
+    TabulatedKernels()
+        : _scale( 0 )
+        , _maxPosition( 0 )
+    {
+    }
+
+    template <class Kernels>
+    TabulatedKernels( const Kernels& kernels, float smoothingRadius, unsigned int nbSamples = 4096 )
+        : _scale( nbSamples / ( smoothingRadius * smoothingRadius ) )
+        , _maxPosition( nbSamples )
+        , _samples( ( nbSamples + 2 ) * 4 )
+    {
+        // The sample at h^2 is repeated so that the interpolation never reads past the table
+        for ( unsigned int i=0 ; i<nbSamples + 2 ; ++i )
+        {
+            float r2 = qMin( i, nbSamples ) / _scale;
+
+            _samples[4 * i + 0] = kernels.density( r2 );
+            _samples[4 * i + 1] = kernels.pressure( r2 );
+            _samples[4 * i + 2] = kernels.viscosity( r2 );
+            _samples[4 * i + 3] = 0;
+        }
+    }
+
+    float density( float r2 ) const
+    {
+        return lookup( r2, 0 );
+    }
+
+    float pressure( float r2 ) const
+    {
+        return lookup( r2, 1 );
+    }
+
+    float viscosity( float r2 ) const
+    {
+        return lookup( r2, 2 );
+    }
+
+private:
+    float lookup( float r2, unsigned int kernel ) const
+    {
+        float position = qMin( r2 * _scale, _maxPosition );
+        int i = int( position );
+        float t = position - i;
+        const float* samples = _samples.constData() + 4 * i + kernel;
+
+        return samples[0] + t * ( samples[4] - samples[0] );
+    }
+
+private:
+    float _scale;
+    float _maxPosition;
+    QVector<float> _samples; // density, pressure, viscosity and padding for each sample
+};
+
+#endif // TABULATEDKERNELS_H
@@ -0,0 +1,87 @@
+#include "WorkPartition.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+WorkPartition::WorkPartition()
+    : _busyTimes( nbThreads() )
+{
+}
+
+void WorkPartition::balance( const unsigned int* costs, unsigned int nbItems )
+{
+    int nbThreads = _busyTimes.size();
+    quint64 totalCost = 0;
+    _busyTimes.fill( 0 );
+
+    for ( unsigned int i=0 ; i<nbItems ; ++i )
+        totalCost += costs[i];
+
+    // Range 'k' ends at the first item where the cost so far reaches k/n of the total
+    _rangeStarts.resize( nbThreads + 1 );
+    _rangeStarts[0] = 0;
+    quint64 cost = 0;
+    unsigned int item = 0;
+
+    for ( int k=1 ; k<nbThreads ; ++k )
+    {
+        quint64 targetCost = totalCost * k / nbThreads;
+
+        while ( item < nbItems && cost < targetCost )
+            cost += costs[item++];
+
+        _rangeStarts[k] = item;
+    }
+
+    _rangeStarts[nbThreads] = nbItems;
+}
+
+void WorkPartition::split( unsigned int nbItems )
+{
+    _busyTimes.fill( 0 );
+    _rangeStarts.resize( nbItems + 1 );
+
+    for ( unsigned int i=0 ; i<=nbItems ; ++i )
+        _rangeStarts[i] = i;
+}
+
+int WorkPartition::nbRanges() const
+{
+    return _rangeStarts.size() - 1;
+}
+
+unsigned int WorkPartition::begin( int range ) const
+{
+    return _rangeStarts[range];
+}
+
+unsigned int WorkPartition::end( int range ) const
+{
+    return _rangeStarts[range + 1];
+}
+
+void WorkPartition::recordBusyTime( qint64 nanoseconds )
+{
+#ifdef _OPENMP
+    int thread = omp_get_thread_num();
+#else
+    int thread = 0;
+#endif
+
+    _busyTimes[thread] = nanoseconds;
+}
+
+const QVector<qint64>& WorkPartition::busyTimes() const
+{
+    return _busyTimes;
+}
+
+int WorkPartition::nbThreads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
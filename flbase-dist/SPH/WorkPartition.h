@@ -0,0 +1,41 @@
+#ifndef WORKPARTITION_H
+#define WORKPARTITION_H
+
+#include <QVector>
+#include <QtGlobal>
+
+/* Splits the items of a parallel loop into ranges of consecutive items, the
+ * loop handing out ranges instead of items. Balanced by costs, there is one
+ * range per OpenMP thread with about the same total cost, so a thread that got
+ * the dense cells does not keep the others waiting, and since the items are in
+ * grid order, each thread works on a compact block of the space. Without the
+ * costs, every item is a range, as with a loop over the items.
+ *
+ * The time each thread spent in the loop is kept to measure the imbalance
+ * ( see Profiler::recordThreadTimes ).
+ */
+
+class WorkPartition
+{
+public:
+    WorkPartition();
+
+    void balance( const unsigned int* costs, unsigned int nbItems );
+    void split( unsigned int nbItems );
+
+    int nbRanges() const;
+    unsigned int begin( int range ) const;
+    unsigned int end( int range ) const;
+
+    // From inside the parallel region, by each thread
+    void recordBusyTime( qint64 nanoseconds );
+    const QVector<qint64>& busyTimes() const;
+
+    static int nbThreads();
+
+private:
+    QVector<unsigned int> _rangeStarts;
+    QVector<qint64> _busyTimes;
+};
+
+#endif // WORKPARTITION_H
@@ -1,4 +1,9 @@
 #include "Scene.h"
+#include "Scenes/SceneCube.h"
+#include "Scenes/SceneCylinder.h"
+#include "Scenes/SceneHoney.h"
+#include "Scenes/SceneSphere.h"
+#include "Scenes/SceneSphereHighRes.h"
 
 Scene::Scene()
     : _camera( this )
@@ -18,3 +23,15 @@ Camera& Scene::activeCamera()
 {
     return _camera;
 }
+
+QVector<QPair<QString,Scene*> > Scene::createScenes()
+{
+    QVector<QPair<QString,Scene*> > scenes;
+    scenes.append( QPair<QString,Scene*>( "Sphere", new SceneSphere ) );
+    scenes.append( QPair<QString,Scene*>( "Cube", new SceneCube ) );
+    scenes.append( QPair<QString,Scene*>( "Cylinder", new SceneCylinder ) );
+    scenes.append( QPair<QString,Scene*>( "Sphere - High resolution", new SceneSphereHighRes ) );
+    scenes.append( QPair<QString,Scene*>( "Honey", new SceneHoney ) );
+
+    return scenes;
+}
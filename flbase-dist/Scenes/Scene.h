@@ -4,10 +4,13 @@
 #include "Geometry/Camera.h"
 #include "SPH/SPH.h"
 #include "TimeState.h"
+#include <QPair>
+#include <QString>
+#include <QVector>
 
 /* Every scene must implement derive from Scene, and added in
- * MainWindow::buildSceneList() to be visible in the scene list
- * widget.
+ * Scene::createScenes() to be visible in the scene list
+ * widget and from the command line.
  */
 
 class Scene : public AbstractObject
@@ -21,6 +24,9 @@ public:
 
     virtual SPH& sph()=0;
 
+    // Every scene with its name. The caller owns the scenes.
+    static QVector<QPair<QString,Scene*> > createScenes();
+
 protected:
     Camera _camera;
 };
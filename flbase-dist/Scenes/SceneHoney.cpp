@@ -0,0 +1,37 @@
+#include "Scenes/SceneHoney.h"
+
+SceneHoney::SceneHoney()
+    : _sky( this, Material() )
+    , _cube( 0, Material() )
+    , _water( this, _cube,
+              0.09, 1000, 5000, 0.3,
+              20, 20, 20,
+              30, 30, 30,
+              3000,
+              998.29,
+              1.5,
+              0.01,
+              QVector3D( 0, -9.81, 0 ) )
+{
+    _sky.localTransformation().scale( 100 );
+    _cube.setParent( &_water );
+    _camera.lookAt( QVector3D(  0,  2, -2 ),
+                    QVector3D(  0,  0,  0 ),
+                    QVector3D(  0,  1,  0 ) );
+
+    // The explicit viscosity is unstable at this viscosity with this time step
+    _water.setViscosityImplicit( true );
+
+    // With the implicit viscosity, the leapfrog stays stable with larger time
+    // steps ( see IntegratorComparison )
+    _water.setIntegrator( SPH::LeapfrogIntegrator );
+}
+
+SceneHoney::~SceneHoney()
+{
+}
+
+SPH& SceneHoney::sph()
+{
+    return _water;
+}
@@ -0,0 +1,22 @@
+#ifndef SCENEHONEY_H
+#define SCENEHONEY_H
+
+#include "Scene.h"
+#include "Geometry/Cube.h"
+#include "SPH/SPH.h"
+
+class SceneHoney : public Scene
+{
+public:
+    SceneHoney();
+    virtual ~SceneHoney();
+
+    virtual SPH& sph();
+
+private:
+    Cube _sky;
+    Cube _cube;
+    SPH _water;
+};
+
+#endif // SCENEHONEY_H
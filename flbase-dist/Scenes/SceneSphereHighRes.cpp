@@ -6,7 +6,7 @@ SceneSphereHighRes::SceneSphereHighRes()
     , _water( this, _sphere,
               0.06, 20, 5000, 0.3,
               40, 40, 40,
-              80, 80, 80,
+              60, 60, 60,
               25000,
               998.29,
               0.5,
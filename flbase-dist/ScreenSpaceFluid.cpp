@@ -0,0 +1,274 @@
+#include "ScreenSpaceFluid.h"
+#include "FrameArena.h"
+#include <QtOpenGL>
+
+#if !defined(GL_RGBA32F_ARB)
+#define GL_RGBA32F_ARB 0x8814
+#endif
+
+#if !defined(GL_FRAMEBUFFER_BINDING)
+#define GL_FRAMEBUFFER_BINDING 0x8CA6
+#endif
+
+#if !defined(GL_POINT_SPRITE)
+#define GL_POINT_SPRITE 0x8861
+#endif
+
+#if !defined(GL_VERTEX_PROGRAM_POINT_SIZE)
+#define GL_VERTEX_PROGRAM_POINT_SIZE 0x8642
+#endif
+
+namespace
+{
+    // Largest half width of the bilateral filter, in pixels
+    static float maxFilterSize = 12;
+
+    // Depth difference, in eye space units, past which the filter ignores samples
+    static float depthFalloff = 0.05;
+
+    // Light absorbed per unit of fluid thickness, for red, green and blue
+    static QVector3D absorption( 2.0, 0.7, 0.25 );
+
+    void buildProgram( QGLShaderProgram& program, const QString& vertexShader, const QString& fragmentShader,
+                       bool withFresnel = false )
+    {
+        program.addShaderFromSourceFile( QGLShader::Vertex, vertexShader );
+        program.addShaderFromSourceFile( QGLShader::Fragment, fragmentShader );
+
+        if ( withFresnel )
+            program.addShaderFromSourceFile( QGLShader::Fragment, ":/Shaders/Fresnel.fs" );
+
+        program.link();
+    }
+}
+
+ScreenSpaceFluid::ScreenSpaceFluid()
+    : _isInitialized( false )
+    , _depthBuffer( 0 )
+    , _smoothBuffer( 0 )
+    , _thicknessBuffer( 0 )
+    , _pointBuffer( QGLBuffer::VertexBuffer )
+    , _quadBuffer( QGLBuffer::VertexBuffer )
+    , _pointBufferSize( 0 )
+{
+}
+
+ScreenSpaceFluid::~ScreenSpaceFluid()
+{
+    delete _depthBuffer;
+    delete _smoothBuffer;
+    delete _thicknessBuffer;
+}
+
+void ScreenSpaceFluid::render( const QVector<Particle>& particles, float radius, const QMatrix4x4& transformation,
+                               GLShader& shader, const Material& material )
+{
+    if ( !_isInitialized )
+        initialize();
+
+    GLint viewport[4];
+    glGetIntegerv( GL_VIEWPORT, viewport );
+    resize( viewport[2], viewport[3] );
+
+    // Releasing a framebuffer object goes back to the window, which is not
+    // the target when rendering offscreen
+    GLint targetFramebuffer;
+    glGetIntegerv( GL_FRAMEBUFFER_BINDING, &targetFramebuffer );
+
+    // The particle positions are all that is sent each frame
+    int nbParticles = particles.size();
+    QVector3D* points = FrameArena::frameArena().allocate<QVector3D>( nbParticles );
+
+    for ( int i=0 ; i<nbParticles ; ++i )
+        points[i] = particles[i].position();
+
+    _pointBuffer.bind();
+    _pointBuffer.allocate( points, nbParticles * sizeof( QVector3D ) );
+    _pointBuffer.release();
+    _pointBufferSize = nbParticles * sizeof( QVector3D );
+
+    const QMatrix4x4& cameraTransformation = shader.cameraTransformation();
+    const QMatrix4x4& projection = shader.projectionMatrix();
+    QMatrix4x4 modelView = cameraTransformation.inverted() * transformation;
+    float pointScale = viewport[3] * projection( 1, 1 ) * 0.5;
+
+    GLfloat clearColor[4];
+    glGetFloatv( GL_COLOR_CLEAR_VALUE, clearColor );
+    glClearColor( 0, 0, 0, 0 );
+
+    glEnable( GL_VERTEX_PROGRAM_POINT_SIZE );
+    glEnable( GL_POINT_SPRITE );
+
+    // Depth of the nearest spheres
+    _depthBuffer->bind();
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    renderSplats( _depthProgram, modelView, projection, radius, pointScale, nbParticles );
+    _depthBuffer->release();
+
+    // Thickness of all the spheres
+    _thicknessBuffer->bind();
+    glClear( GL_COLOR_BUFFER_BIT );
+    glDisable( GL_DEPTH_TEST );
+    glEnable( GL_BLEND );
+    glBlendFunc( GL_ONE, GL_ONE );
+    renderSplats( _thicknessProgram, modelView, projection, radius, pointScale, nbParticles );
+    glDisable( GL_BLEND );
+    _thicknessBuffer->release();
+
+    glDisable( GL_POINT_SPRITE );
+    glDisable( GL_VERTEX_PROGRAM_POINT_SIZE );
+
+    // Separable bilateral filter, back into the depth buffer
+    smoothDepth( *_depthBuffer, *_smoothBuffer, QVector2D( 1.0 / viewport[2], 0 ), radius, pointScale );
+    smoothDepth( *_smoothBuffer, *_depthBuffer, QVector2D( 0, 1.0 / viewport[3] ), radius, pointScale );
+
+    _functions.glBindFramebuffer( GL_FRAMEBUFFER, targetFramebuffer );
+    glEnable( GL_DEPTH_TEST );
+    glClearColor( clearColor[0], clearColor[1], clearColor[2], clearColor[3] );
+
+    // Shade the fluid surface over the scene
+    _shadeProgram.bind();
+    _shadeProgram.setUniformValue( "projectionMatrix", projection );
+    _shadeProgram.setUniformValue( "cameraMatrix", cameraTransformation );
+    _shadeProgram.setUniformValue( "texelSize", QVector2D( 1.0 / viewport[2], 1.0 / viewport[3] ) );
+    _shadeProgram.setUniformValue( "absorption", absorption );
+    _shadeProgram.setUniformValue( "light.direction", cameraTransformation.column( 2 ).toVector3D() );
+    _shadeProgram.setUniformValue( "material.isUsingCubemap", material.isUsingCubemap() );
+    _shadeProgram.setUniformValue( "material.diffuse", material.diffuse() );
+    _shadeProgram.setUniformValue( "material.refractiveIndex", material.refractiveIndex() );
+    _shadeProgram.setUniformValue( "material.enableRefraction", ( material.refractiveIndex() != 1 ) ? true : false );
+    _shadeProgram.setUniformValue( "environment", 0 );
+    _shadeProgram.setUniformValue( "depthTexture", 1 );
+    _shadeProgram.setUniformValue( "thicknessTexture", 2 );
+
+    bindTexture( 1, _depthBuffer->texture() );
+    bindTexture( 2, _thicknessBuffer->texture() );
+    renderQuad( _shadeProgram );
+    bindTexture( 2, 0 );
+    bindTexture( 1, 0 );
+    _functions.glActiveTexture( GL_TEXTURE0 );
+
+    // Back to the regular shader
+    shader.bind();
+}
+
+size_t ScreenSpaceFluid::bufferMemoryUsage() const
+{
+    return _pointBufferSize;
+}
+
+void ScreenSpaceFluid::initialize()
+{
+    _functions.initializeGLFunctions();
+
+    buildProgram( _depthProgram, ":/Shaders/ScreenSpaceSplat.vs", ":/Shaders/ScreenSpaceDepth.fs" );
+    buildProgram( _thicknessProgram, ":/Shaders/ScreenSpaceSplat.vs", ":/Shaders/ScreenSpaceThickness.fs" );
+    buildProgram( _smoothProgram, ":/Shaders/ScreenSpaceQuad.vs", ":/Shaders/ScreenSpaceSmooth.fs" );
+    buildProgram( _shadeProgram, ":/Shaders/ScreenSpaceQuad.vs", ":/Shaders/ScreenSpaceShade.fs", true );
+
+    _pointBuffer.create();
+    _pointBuffer.bind();
+    _pointBuffer.setUsagePattern( QGLBuffer::StreamDraw );
+    _pointBuffer.release();
+
+    // Two triangles covering the screen
+    const GLfloat quad[8] = { -1, -1, 1, -1, -1, 1, 1, 1 };
+
+    _quadBuffer.create();
+    _quadBuffer.bind();
+    _quadBuffer.setUsagePattern( QGLBuffer::StaticDraw );
+    _quadBuffer.allocate( quad, sizeof( quad ) );
+    _quadBuffer.release();
+
+    _isInitialized = true;
+}
+
+void ScreenSpaceFluid::resize( int width, int height )
+{
+    if ( _depthBuffer && _depthBuffer->size() == QSize( width, height ) )
+        return;
+
+    delete _depthBuffer;
+    delete _smoothBuffer;
+    delete _thicknessBuffer;
+
+    // Floating point targets, the depth is stored in eye space
+    _depthBuffer = new QGLFramebufferObject( width, height, QGLFramebufferObject::Depth, GL_TEXTURE_2D, GL_RGBA32F_ARB );
+    _smoothBuffer = new QGLFramebufferObject( width, height, QGLFramebufferObject::NoAttachment, GL_TEXTURE_2D, GL_RGBA32F_ARB );
+    _thicknessBuffer = new QGLFramebufferObject( width, height, QGLFramebufferObject::NoAttachment, GL_TEXTURE_2D, GL_RGBA32F_ARB );
+
+    // The depth must not be interpolated across silhouettes
+    QGLFramebufferObject* buffers[3] = { _depthBuffer, _smoothBuffer, _thicknessBuffer };
+
+    for ( unsigned int i=0 ; i<3 ; ++i )
+    {
+        glBindTexture( GL_TEXTURE_2D, buffers[i]->texture() );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    }
+
+    glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+void ScreenSpaceFluid::renderSplats( QGLShaderProgram& program, const QMatrix4x4& modelView, const QMatrix4x4& projection,
+                                     float radius, float pointScale, int nbParticles )
+{
+    program.bind();
+    program.setUniformValue( "modelViewMatrix", modelView );
+    program.setUniformValue( "projectionMatrix", projection );
+    program.setUniformValue( "radius", radius );
+    program.setUniformValue( "pointScale", pointScale );
+
+    int vertexLocation = program.attributeLocation( "vertex" );
+
+    _pointBuffer.bind();
+    program.setAttributeBuffer( vertexLocation, GL_FLOAT, 0, 3 );
+    program.enableAttributeArray( vertexLocation );
+    _pointBuffer.release();
+
+    glDrawArrays( GL_POINTS, 0, nbParticles );
+
+    program.disableAttributeArray( vertexLocation );
+}
+
+void ScreenSpaceFluid::smoothDepth( QGLFramebufferObject& source, QGLFramebufferObject& destination, const QVector2D& direction,
+                                    float radius, float pointScale )
+{
+    destination.bind();
+
+    _smoothProgram.bind();
+    _smoothProgram.setUniformValue( "depthTexture", 1 );
+    _smoothProgram.setUniformValue( "direction", direction );
+    _smoothProgram.setUniformValue( "radius", radius );
+    _smoothProgram.setUniformValue( "pointScale", pointScale );
+    _smoothProgram.setUniformValue( "maxFilterSize", maxFilterSize );
+    _smoothProgram.setUniformValue( "depthFalloff", depthFalloff );
+
+    bindTexture( 1, source.texture() );
+    renderQuad( _smoothProgram );
+    bindTexture( 1, 0 );
+
+    destination.release();
+}
+
+void ScreenSpaceFluid::renderQuad( QGLShaderProgram& program )
+{
+    int vertexLocation = program.attributeLocation( "vertex" );
+
+    _quadBuffer.bind();
+    program.setAttributeBuffer( vertexLocation, GL_FLOAT, 0, 2 );
+    program.enableAttributeArray( vertexLocation );
+    _quadBuffer.release();
+
+    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+
+    program.disableAttributeArray( vertexLocation );
+}
+
+void ScreenSpaceFluid::bindTexture( unsigned int unit, GLuint texture )
+{
+    _functions.glActiveTexture( GL_TEXTURE0 + unit );
+    glBindTexture( GL_TEXTURE_2D, texture );
+}
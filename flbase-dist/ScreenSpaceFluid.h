@@ -0,0 +1,61 @@
+#ifndef SCREENSPACEFLUID_H
+#define SCREENSPACEFLUID_H
+
+#include "SPH/Particle.h"
+#include "GLShader.h"
+#include <QGLBuffer>
+#include <QGLFramebufferObject>
+#include <QGLFunctions>
+#include <QGLShaderProgram>
+
+/* Renders the fluid from its particles without building a mesh. The particles
+ * are drawn as spheres into a depth buffer, which is smoothed by a bilateral
+ * filter, and into a thickness buffer. A last pass over the screen rebuilds
+ * the normals from the smoothed depth and shades the fluid like Refraction.fs,
+ * the light being absorbed along the thickness. The cost depends on the
+ * number of pixels instead of the size of a lattice.
+ *
+ * See W. J. van der Laan, S. Green et M. Sainz. 2009
+ *     Screen space fluid rendering with curvature flow.
+ */
+
+class ScreenSpaceFluid
+{
+public:
+    ScreenSpaceFluid();
+    ~ScreenSpaceFluid();
+
+    void render( const QVector<Particle>& particles, float radius, const QMatrix4x4& transformation,
+                 GLShader& shader, const Material& material );
+
+    size_t bufferMemoryUsage() const;
+
+private:
+    void initialize();
+    void resize( int width, int height );
+    void renderSplats( QGLShaderProgram& program, const QMatrix4x4& modelView, const QMatrix4x4& projection,
+                       float radius, float pointScale, int nbParticles );
+    void smoothDepth( QGLFramebufferObject& source, QGLFramebufferObject& destination, const QVector2D& direction,
+                      float radius, float pointScale );
+    void renderQuad( QGLShaderProgram& program );
+    void bindTexture( unsigned int unit, GLuint texture );
+
+private:
+    bool _isInitialized;
+    QGLFunctions _functions;
+
+    QGLShaderProgram _depthProgram;
+    QGLShaderProgram _thicknessProgram;
+    QGLShaderProgram _smoothProgram;
+    QGLShaderProgram _shadeProgram;
+
+    QGLFramebufferObject* _depthBuffer;
+    QGLFramebufferObject* _smoothBuffer;
+    QGLFramebufferObject* _thicknessBuffer;
+
+    QGLBuffer _pointBuffer;
+    QGLBuffer _quadBuffer;
+    size_t _pointBufferSize;
+};
+
+#endif // SCREENSPACEFLUID_H
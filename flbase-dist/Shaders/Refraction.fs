@@ -21,24 +21,10 @@ varying vec3 vVertex;
 varying vec3 vNormal;
 varying vec3 vEyeDirection;
 
+// See Fresnel.fs
 void computeRefraction( in vec3 incom, in vec3 normal, in float indexExternal, in float indexInternal,
                         out vec3 reflection, out vec3 refraction,
-                        out float reflectance, out float transmittance )
-{
-    float eta = indexExternal / indexInternal;
-    float cosTheta1 = max( 0, dot( incom, normal ) );
-    float disc = max( 0, 1.0 - ( ( eta * eta ) * ( 1.0 - ( cosTheta1 * cosTheta1 ) ) ) );
-
-    float cosTheta2 = sqrt( disc );
-    reflection = 2.0 * cosTheta1 * normal - incom;
-    refraction = ( eta * cosTheta1 - cosTheta2 ) * normal - ( eta * incom );
-
-    float fresnelRS = max( 0, ( indexExternal * cosTheta1 - indexInternal * cosTheta2 ) / ( indexExternal * cosTheta1 + indexInternal * cosTheta2 ) );
-    float fresnelRP = max( 0, ( indexInternal * cosTheta1 - indexExternal * cosTheta2 ) / ( indexInternal * cosTheta1 + indexExternal * cosTheta2 ) );
-
-    reflectance = ( fresnelRS * fresnelRS + fresnelRP * fresnelRP ) / 2.0;
-    transmittance =  ( ( 1.0 - fresnelRS ) * ( 1.0 - fresnelRS ) + ( 1.0 - fresnelRP ) * ( 1.0 - fresnelRP ) ) / 2.0;
-}
+                        out float reflectance, out float transmittance );
 
 void main()
 {
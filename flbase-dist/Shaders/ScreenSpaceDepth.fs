@@ -0,0 +1,26 @@
+#version 120
+
+uniform mat4 projectionMatrix;
+uniform float radius;
+
+varying vec3 vEyeCenter;
+
+void main()
+{
+    // Normal of the sphere seen through the point sprite
+    vec3 N;
+    N.xy = gl_PointCoord * vec2( 2.0, -2.0 ) + vec2( -1.0, 1.0 );
+    float r2 = dot( N.xy, N.xy );
+
+    if ( r2 > 1.0 )
+        discard;
+
+    N.z = sqrt( 1.0 - r2 );
+
+    // Nearest point of the sphere, its eye space depth goes in red
+    vec4 eyePosition = vec4( vEyeCenter + N * radius, 1.0 );
+    vec4 clipPosition = projectionMatrix * eyePosition;
+
+    gl_FragDepth = ( clipPosition.z / clipPosition.w ) * 0.5 + 0.5;
+    gl_FragColor = vec4( eyePosition.z, 0.0, 0.0, 1.0 );
+}
@@ -0,0 +1,11 @@
+#version 120
+
+attribute vec2 vertex;
+
+varying vec2 vTexCoord;
+
+void main()
+{
+    vTexCoord = vertex * 0.5 + 0.5;
+    gl_Position = vec4( vertex, 0.0, 1.0 );
+}
@@ -0,0 +1,98 @@
+#version 120
+
+struct Light
+{
+    vec3 direction;
+};
+
+struct Material
+{
+    bool isUsingCubemap;
+    vec4 diffuse;
+    bool enableRefraction;
+    float refractiveIndex;
+};
+
+uniform Light light;
+uniform Material material;
+uniform samplerCube environment;
+uniform sampler2D depthTexture;
+uniform sampler2D thicknessTexture;
+uniform mat4 projectionMatrix;
+uniform mat4 cameraMatrix; // Eye space to world space
+uniform vec2 texelSize;
+uniform vec3 absorption;   // Per unit of thickness, for each channel
+
+varying vec2 vTexCoord;
+
+// See Fresnel.fs
+void computeRefraction( in vec3 incom, in vec3 normal, in float indexExternal, in float indexInternal,
+                        out vec3 reflection, out vec3 refraction,
+                        out float reflectance, out float transmittance );
+
+vec3 eyePosition( vec2 texCoord )
+{
+    float z = texture2D( depthTexture, texCoord ).r;
+    vec2 ndc = texCoord * 2.0 - 1.0;
+
+    return vec3( -z * ( ndc.x + projectionMatrix[2][0] ) / projectionMatrix[0][0],
+                 -z * ( ndc.y + projectionMatrix[2][1] ) / projectionMatrix[1][1],
+                 z );
+}
+
+void main()
+{
+    float depth = texture2D( depthTexture, vTexCoord ).r;
+
+    if ( depth == 0.0 )
+        discard;
+
+    // Normal from the smoothed depth, using the side with the smallest jump
+    vec3 position = eyePosition( vTexCoord );
+    vec3 ddx = eyePosition( vTexCoord + vec2( texelSize.x, 0.0 ) ) - position;
+    vec3 ddx2 = position - eyePosition( vTexCoord - vec2( texelSize.x, 0.0 ) );
+    vec3 ddy = eyePosition( vTexCoord + vec2( 0.0, texelSize.y ) ) - position;
+    vec3 ddy2 = position - eyePosition( vTexCoord - vec2( 0.0, texelSize.y ) );
+
+    if ( abs( ddx2.z ) < abs( ddx.z ) )
+        ddx = ddx2;
+
+    if ( abs( ddy2.z ) < abs( ddy.z ) )
+        ddy = ddy2;
+
+    vec3 N = normalize( mat3( cameraMatrix ) * cross( ddx, ddy ) );
+    vec3 vertex = vec3( cameraMatrix * vec4( position, 1.0 ) );
+    float thickness = texture2D( thicknessTexture, vTexCoord ).r;
+
+    // Same shading as Refraction.fs, with the light absorbed through the fluid
+    gl_FragColor = vec4( 0, 0, 0, 1 );
+
+    if ( material.isUsingCubemap )
+    {
+        gl_FragColor = textureCube( environment, vertex );
+    }
+    else
+    {
+        float nDotD = abs( dot( N, light.direction ) );
+        gl_FragColor.rgb = material.diffuse.rgb * nDotD;
+        gl_FragColor.a = material.diffuse.a;
+    }
+
+    if ( material.enableRefraction )
+    {
+        vec3 incom = normalize( cameraMatrix[3].xyz - vertex );
+        vec3 refractionRay, reflectionRay;
+        float fresnelR, fresnelT;
+
+        computeRefraction( incom, N, 1.0, material.refractiveIndex, reflectionRay, refractionRay, fresnelR, fresnelT );
+
+        vec4 reflectColor = textureCube( environment, reflectionRay ) * fresnelR;
+        vec4 refractColor = textureCube( environment, refractionRay ) * fresnelT;
+        refractColor.rgb *= exp( -absorption * thickness );
+        gl_FragColor.rgb += reflectColor.rgb + refractColor.rgb;
+    }
+
+    // Depth of the smoothed surface, so the scene still occludes the fluid
+    vec4 clipPosition = projectionMatrix * vec4( position, 1.0 );
+    gl_FragDepth = ( clipPosition.z / clipPosition.w ) * 0.5 + 0.5;
+}
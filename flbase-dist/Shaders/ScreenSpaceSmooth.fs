@@ -0,0 +1,45 @@
+#version 120
+
+uniform sampler2D depthTexture;
+uniform vec2 direction;       // One texel along the filtered axis
+uniform float radius;         // Of the particles
+uniform float pointScale;     // See ScreenSpaceSplat.vs
+uniform float maxFilterSize;  // In texels
+uniform float depthFalloff;   // Depth difference past which samples are ignored
+
+varying vec2 vTexCoord;
+
+void main()
+{
+    float depth = texture2D( depthTexture, vTexCoord ).r;
+
+    // Background
+    if ( depth == 0.0 )
+    {
+        gl_FragColor = vec4( 0.0 );
+        return;
+    }
+
+    // Bilateral filter : gaussian over the size of a particle on screen,
+    // without blurring across depth discontinuities
+    float filterSize = min( pointScale * radius / -depth, maxFilterSize );
+    float sigma = max( filterSize * 0.5, 0.5 );
+    float sum = 0.0;
+    float totalWeight = 0.0;
+
+    for ( float x=-filterSize ; x<=filterSize ; x+=1.0 )
+    {
+        float sampleDepth = texture2D( depthTexture, vTexCoord + x * direction ).r;
+
+        if ( sampleDepth == 0.0 )
+            continue;
+
+        float difference = ( sampleDepth - depth ) / depthFalloff;
+        float weight = exp( -x * x / ( 2.0 * sigma * sigma ) - difference * difference );
+
+        sum += sampleDepth * weight;
+        totalWeight += weight;
+    }
+
+    gl_FragColor = vec4( sum / totalWeight, 0.0, 0.0, 1.0 );
+}
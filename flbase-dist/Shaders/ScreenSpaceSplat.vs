@@ -0,0 +1,19 @@
+#version 120
+
+uniform mat4 modelViewMatrix;
+uniform mat4 projectionMatrix;
+uniform float radius;
+uniform float pointScale; // Size in pixels of one unit at a distance of one
+
+attribute vec3 vertex;
+
+varying vec3 vEyeCenter;
+
+void main()
+{
+    vec4 eyePosition = modelViewMatrix * vec4( vertex, 1.0 );
+
+    vEyeCenter = eyePosition.xyz;
+    gl_PointSize = pointScale * radius / -eyePosition.z;
+    gl_Position = projectionMatrix * eyePosition;
+}
@@ -0,0 +1,15 @@
+#version 120
+
+uniform float radius;
+
+void main()
+{
+    vec2 coord = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot( coord, coord );
+
+    if ( r2 > 1.0 )
+        discard;
+
+    // Length of the sphere along the view ray, summed by additive blending
+    gl_FragColor = vec4( 2.0 * radius * sqrt( 1.0 - r2 ), 0.0, 0.0, 1.0 );
+}
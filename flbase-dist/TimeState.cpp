@@ -14,6 +14,13 @@ void TimeState::newFrame()
     _timer.restart();
 }
 
+void TimeState::newFrame( float deltaTime )
+{
+    _deltaTime = deltaTime;
+    _time += _deltaTime;
+    _timer.restart();
+}
+
 float TimeState::time() const
 {
     return _time;
@@ -5,7 +5,8 @@
 
 /* TimeState contains the information about the time (in seconds)
  * for the current frame. deltaTime is the difference
- * in time between the current and the previous frame.
+ * in time between the current and the previous frame, or a fixed
+ * step when the frames are not shown in real time.
  */
 
 class TimeState
@@ -14,6 +15,7 @@ public:
     TimeState();
 
     void newFrame();
+    void newFrame( float deltaTime );
     float time() const;
     float deltaTime() const;
 
@@ -9,7 +9,7 @@ DEFINES += _USE_MATH_DEFINES
 CONFIG(debug,debug|release) {
 } else {
     QMAKE_CXXFLAGS -= -O2
-    QMAKE_CXXFLAGS += -O3 -fopenmp
+    QMAKE_CXXFLAGS += -O3 -fopenmp -fno-math-errno -fno-trapping-math
     QMAKE_LFLAGS -= -O1
     QMAKE_LFLAGS += -O3 -fopenmp
 }
@@ -23,35 +23,61 @@ QMAKE_CXXFLAGS += -std=gnu++0x
 }
 
 SOURCES += \
+    Geometry/AbstractMarchingTetrahedra.cpp \
     Geometry/AbstractObject.cpp \
+    Geometry/AdaptiveMarchingTetrahedra.cpp \
     Geometry/BoundingBox.cpp \
     Geometry/Camera.cpp \
     Geometry/Cube.cpp \
     Geometry/Cylinder.cpp \
     Geometry/Geometry.cpp \
     Geometry/Intersection.cpp \
+    Geometry/IntersectionBatch.cpp \
     Geometry/MarchingTetrahedra.cpp \
+    Geometry/MeshPool.cpp \
     Geometry/Ray.cpp \
+    Geometry/RayBatch.cpp \
     Geometry/Sphere.cpp \
     Scenes/Scene.cpp \
     Scenes/SceneCube.cpp \
     Scenes/SceneCylinder.cpp \
+    Scenes/SceneHoney.cpp \
     Scenes/SceneSphere.cpp \
     Scenes/SceneSphereHighRes.cpp \
+    SPH/AnisotropicKernel.cpp \
     SPH/Grid.cpp \
     SPH/Particle.cpp \
     SPH/Particles.cpp \
+    SPH/ParticleTiles.cpp \
     SPH/SPH.cpp \
+    SPH/SurfaceThread.cpp \
+    SPH/WorkPartition.cpp \
+    BatchRunner.cpp \
     CubeMap.cpp \
+    FrameArena.cpp \
+    FrameScheduler.cpp \
     GLShader.cpp \
     GLWidget.cpp \
+    HardwareCounters.cpp \
+    ImageSequenceWriter.cpp \
+    InputScript.cpp \
+    IntegratorComparison.cpp \
+    KernelComparison.cpp \
+    LatencyHistogram.cpp \
+    LiveMetrics.cpp \
     Main.cpp \
     MainWindow.cpp \
     Material.cpp \
+    MemoryFootprint.cpp \
+    MetricsServer.cpp \
+    Profiler.cpp \
+    ScreenSpaceFluid.cpp \
     TimeState.cpp
 
 HEADERS  += \
+    Geometry/AbstractMarchingTetrahedra.h \
     Geometry/AbstractObject.h \
+    Geometry/AdaptiveMarchingTetrahedra.h \
     Geometry/BoundingBox.h \
     Geometry/Camera.h \
     Geometry/Cube.h \
@@ -59,23 +85,48 @@ HEADERS  += \
     Geometry/Geometry.h \
     Geometry/ImplicitSurface.h \
     Geometry/Intersection.h \
+    Geometry/IntersectionBatch.h \
     Geometry/MarchingTetrahedra.h \
+    Geometry/MeshPool.h \
     Geometry/Ray.h \
+    Geometry/RayBatch.h \
     Geometry/Sphere.h \
     Scenes/Scene.h \
     Scenes/SceneCube.h \
     Scenes/SceneCylinder.h \
+    Scenes/SceneHoney.h \
     Scenes/SceneSphere.h \
     Scenes/SceneSphereHighRes.h \
+    SPH/AnisotropicKernel.h \
     SPH/Grid.h \
+    SPH/Kernels.h \
     SPH/Particle.h \
     SPH/Particles.h \
+    SPH/ParticleTiles.h \
+    SPH/Prefetch.h \
     SPH/SPH.h \
+    SPH/SurfaceThread.h \
+    SPH/TabulatedKernels.h \
+    SPH/WorkPartition.h \
+    BatchRunner.h \
     CubeMap.h \
+    FrameArena.h \
+    FrameScheduler.h \
     GLShader.h \
     GLWidget.h \
+    HardwareCounters.h \
+    ImageSequenceWriter.h \
+    InputScript.h \
+    IntegratorComparison.h \
+    KernelComparison.h \
+    LatencyHistogram.h \
+    LiveMetrics.h \
     MainWindow.h \
     Material.h \
+    MemoryFootprint.h \
+    MetricsServer.h \
+    Profiler.h \
+    ScreenSpaceFluid.h \
     TimeState.h
 
 FORMS    += \
@@ -92,7 +143,14 @@ OTHER_FILES += \
     Images/Checker/XP.png \
     Images/Checker/XN.png \
     Shaders/Refraction.vs \
-    Shaders/Refraction.fs
+    Shaders/Refraction.fs \
+    Shaders/Fresnel.fs \
+    Shaders/ScreenSpaceSplat.vs \
+    Shaders/ScreenSpaceDepth.fs \
+    Shaders/ScreenSpaceThickness.fs \
+    Shaders/ScreenSpaceQuad.vs \
+    Shaders/ScreenSpaceSmooth.fs \
+    Shaders/ScreenSpaceShade.fs
 
 DEPENDPATH += \
     Images/Checker \